@@ -0,0 +1,59 @@
+#include "BorderAnimator.hpp"
+#include "globals.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <hyprland/src/Compositor.hpp>
+#include <hyprland/src/helpers/Monitor.hpp>
+#include <wayland-server-core.h>
+
+CBorderAnimator::~CBorderAnimator() { stop(); }
+
+void CBorderAnimator::start() {
+  if (m_running)
+    return;
+
+  if (!m_timer) {
+    if (!g_pCompositor || !g_pCompositor->m_wlEventLoop)
+      return;
+    m_timer = wl_event_loop_add_timer(g_pCompositor->m_wlEventLoop, onTimer,
+                                      this);
+    if (!m_timer)
+      return;
+  }
+
+  m_running = true;
+  wl_event_source_timer_update(m_timer, 1);
+}
+
+void CBorderAnimator::stop() {
+  if (m_timer) {
+    wl_event_source_remove(m_timer);
+    m_timer = nullptr;
+  }
+  m_running = false;
+}
+
+void CBorderAnimator::tick() {
+  const float FPS =
+      g_pGlobalState->borders.animate(std::chrono::steady_clock::now());
+  if (FPS <= 0.F) {
+    // Left disarmed until the next animated border is drawn
+    m_running = false;
+    return;
+  }
+
+  // Frames in between vblanks would never be seen
+  float refresh = 0.F;
+  for (const auto &m : g_pCompositor->m_monitors)
+    refresh = std::max(refresh, m->m_refreshRate);
+  const float RATE = refresh > 0.F ? std::min(FPS, refresh) : FPS;
+
+  wl_event_source_timer_update(m_timer,
+                               std::max(1, (int)std::lround(1000.F / RATE)));
+}
+
+int CBorderAnimator::onTimer(void *data) {
+  static_cast<CBorderAnimator *>(data)->tick();
+  return 0;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+struct wl_event_source;
+
+// Steps animated borders through their frames on a timer on the compositor's
+// event loop, only damaging their rings. Ticks as fast as the fastest border
+// wants, never faster than the fastest monitor refreshes, and stops by itself
+// once no border is animating.
+class CBorderAnimator {
+public:
+  ~CBorderAnimator();
+
+  // Ticks until no border animates anymore. Called whenever an animated
+  // border is drawn, which is what wakes it up again.
+  void start();
+
+  void stop();
+
+private:
+  void tick();
+
+  static int onTimer(void *data);
+
+  wl_event_source *m_timer = nullptr;
+  bool m_running = false;
+};
@@ -0,0 +1,167 @@
+#include "BorderBatch.hpp"
+#include "ImgBorder.hpp"
+#include "ThemeCache.hpp"
+#include "globals.hpp"
+#include <algorithm>
+#include <hyprland/src/desktop/Popup.hpp>
+#include <hyprland/src/desktop/Window.hpp>
+#include <hyprland/src/desktop/Workspace.hpp>
+#include <hyprland/src/helpers/Monitor.hpp>
+#include <hyprland/src/plugins/PluginAPI.hpp>
+#include <hyprland/src/render/OpenGL.hpp>
+
+void SBorderBatch::draw() {
+  auto &shader = g_pGlobalState->shader;
+
+  if (!theme || !shader.ensureCompiled())
+    return;
+
+  auto &stats = g_pGlobalState->stats;
+  CStatTimer timer(stats, STAT_DRAW);
+  stats.beginGpuTimer();
+
+  static auto *const PCACHE =
+      (Hyprlang::INT *const *)HyprlandAPI::getConfigValue(
+          PHANDLE, "plugin:imgborders:cache")
+          ->getDataStaticPtr();
+
+  const bool OPAQUEPASS =
+      !overlapping && std::ranges::all_of(instances, [](const auto &i) {
+        return i.a >= 1.F;
+      });
+
+  // Boxes are in layout units, the monitor's scale takes them to pixels.
+  // A copy of the theme resampled for it can be sampled 1:1.
+  const auto PMONITOR = monitor.lock();
+  const float MONITORSCALE = PMONITOR ? PMONITOR->m_scale : 1.F;
+  const auto VARIANT =
+      g_pGlobalState->themes.variant(theme, MONITORSCALE * style.scale);
+
+  // Composed textures hold one frame
+  if (!**PCACHE || theme->frames > 1) {
+    shader.draw(*theme, VARIANT.get(), style, instances, MONITORSCALE,
+                OPAQUEPASS);
+    stats.endGpuTimer();
+    return;
+  }
+
+  // Composed borders go out as one quad each. The rest are drawn in runs
+  // between them, so overlapping members keep their order.
+  std::vector<SBorderInstance> run;
+  for (size_t i = 0; i < instances.size(); i++) {
+    const auto &INSTANCE = instances[i];
+    const auto TEX =
+        settled[i] ? g_pGlobalState->composed.get(*theme, VARIANT.get(), style,
+                                                  INSTANCE, MONITORSCALE)
+                   : nullptr;
+    if (!TEX) {
+      run.push_back(INSTANCE);
+      continue;
+    }
+
+    shader.draw(*theme, VARIANT.get(), style, run, MONITORSCALE, OPAQUEPASS);
+    run.clear();
+    // Drawn at its own size, rounded up from the box, so it isn't squeezed
+    // into the box and resampled
+    const CBox BOX = {INSTANCE.box.pos() * MONITORSCALE, TEX->m_size};
+    g_pHyprOpenGL->renderTexture(TEX, BOX, {.a = INSTANCE.a});
+    stats.countDraws(1);
+  }
+  shader.draw(*theme, VARIANT.get(), style, run, MONITORSCALE, OPAQUEPASS);
+  stats.endGpuTimer();
+}
+
+SP<SBorderBatch> CBorderBatcher::add(CImgBorder *border, PHLMONITOR pMonitor,
+                                     const SP<SBorderTheme> &theme,
+                                     const SBorderStyle &style, bool blur,
+                                     const SBorderInstance &instance,
+                                     bool settled, const CRegion &opaque) {
+  static auto *const PBATCH =
+      (Hyprlang::INT *const *)HyprlandAPI::getConfigValue(
+          PHANDLE, "plugin:imgborders:batch")
+          ->getDataStaticPtr();
+
+  const auto PWINDOW = border->getWindow();
+  const auto PWORKSPACE = PWINDOW ? PWINDOW->m_workspace : nullptr;
+
+  // Blurred borders stay on their own so every blur sees the borders drawn
+  // before it, like it did unbatched.
+  const bool CANJOIN = m_open && !blur && m_open->monitor.lock() == pMonitor &&
+                       m_open->workspace.lock() == PWORKSPACE &&
+                       m_open->theme == theme && m_open->style == style;
+
+  if (!CANJOIN) {
+    m_open = makeShared<SBorderBatch>();
+    m_open->monitor = pMonitor;
+    m_open->workspace = PWORKSPACE;
+    m_open->theme = theme;
+    m_open->style = style;
+    m_open->blur = blur;
+  }
+
+  m_open->members.push_back(border);
+  m_open->instances.push_back(instance);
+  m_open->settled.push_back(settled);
+  if (!m_open->area.copy().intersect(instance.box).empty())
+    m_open->overlapping = true;
+  m_open->area.add(instance.box);
+  if (instance.a >= 1.F)
+    m_open->opaque.add(opaque);
+
+  auto batch = m_open;
+  if (!**PBATCH || blur)
+    m_open.reset();
+
+  return batch;
+}
+
+void CBorderBatcher::onRenderWindow(PHLWINDOW pWindow) {
+  if (!pWindow)
+    return;
+
+  const bool SEEN = std::ranges::find(m_renderedWindows, pWindow.get()) !=
+                    m_renderedWindows.end();
+  if (!SEEN)
+    m_renderedWindows.push_back(pWindow.get());
+
+  if (!m_open)
+    return;
+
+  if (SEEN) {
+    close();
+    return;
+  }
+
+  const auto PMONITOR = m_open->monitor.lock();
+  if (!PMONITOR) {
+    close();
+    return;
+  }
+
+  // Popups are drawn right after their window and can go anywhere
+  if (pWindow->m_popupHead && pWindow->m_popupHead->size() > 0) {
+    close();
+    return;
+  }
+
+  // Everything the window paints: its surface, its border, shadow and other
+  // decorations, or the whole monitor if it dims around itself. In the same
+  // space the border boxes are in.
+  CBox box = pWindow->getFullWindowBoundingBox();
+  const auto PWORKSPACE = pWindow->m_workspace;
+  const auto WORKSPACEOFFSET = PWORKSPACE && !pWindow->m_pinned
+                                   ? PWORKSPACE->m_renderOffset->value()
+                                   : Vector2D();
+  box.translate(pWindow->m_floatingOffset - PMONITOR->m_position +
+                WORKSPACEOFFSET);
+
+  if (!m_open->area.copy().intersect(box).empty())
+    close();
+}
+
+void CBorderBatcher::beginFrame() {
+  close();
+  m_renderedWindows.clear();
+}
+
+void CBorderBatcher::close() { m_open.reset(); }
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "BorderShader.hpp"
+#include <hyprland/src/desktop/DesktopTypes.hpp>
+#include <vector>
+
+class CImgBorder;
+struct SBorderTheme;
+
+// Borders merged into one instanced draw. Filled while Hyprland collects the
+// frame's pass elements and drawn by the element of its last member, so every
+// member still ends up above the window it belongs to.
+struct SBorderBatch {
+  PHLMONITORREF monitor;
+  PHLWORKSPACEREF workspace;
+  SP<SBorderTheme> theme;
+  SBorderStyle style;
+  // Blurred behind by separate pass elements, see CImgBorder::draw
+  bool blur = false;
+
+  std::vector<CImgBorder *> members;
+  std::vector<SBorderInstance> instances;
+
+  // Whether each member kept its layout since the last frame, only those are
+  // worth composing into a texture
+  std::vector<bool> settled;
+
+  // Union of the member boxes
+  CRegion area;
+
+  // Members overlap each other. They then need a single blended pass to
+  // stack in order.
+  bool overlapping = false;
+
+  // Covered by fully opaque border pixels, in the same space as area
+  CRegion opaque;
+
+  void draw();
+};
+
+class CBorderBatcher {
+public:
+  // Puts the border in the open batch if it can join without changing what
+  // ends up on top of what, otherwise starts a new batch.
+  SP<SBorderBatch> add(CImgBorder *border, PHLMONITOR pMonitor,
+                       const SP<SBorderTheme> &theme,
+                       const SBorderStyle &style, bool blur,
+                       const SBorderInstance &instance, bool settled,
+                       const CRegion &opaque);
+
+  // A window is about to be rendered. Borders under anything it paints, its
+  // decorations and shadow included, can't be pushed past it anymore, so
+  // they close the open batch. So does any window with popups open.
+  void onRenderWindow(PHLWINDOW pWindow);
+
+  void beginFrame();
+
+  void close();
+
+private:
+  SP<SBorderBatch> m_open;
+
+  // Windows rendered since the frame began. A second render of the same
+  // window is its popup pass, which can go anywhere.
+  std::vector<CWindow *> m_renderedWindows;
+};
@@ -0,0 +1,181 @@
+#include "BorderCache.hpp"
+#include "ThemeCache.hpp"
+#include "globals.hpp"
+#include <cmath>
+#include <functional>
+#include <hyprland/src/plugins/PluginAPI.hpp>
+#include <hyprland/src/render/OpenGL.hpp>
+
+size_t SComposedKeyHash::operator()(const SComposedKey &key) const {
+  size_t h = std::hash<const void *>{}(key.atlas);
+  const auto mix = [&h](float v) {
+    h ^= std::hash<float>{}(v) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+  };
+  for (const auto V : key.style.borders)
+    mix(V);
+  mix(key.style.scale);
+  mix(key.style.smooth);
+  mix(key.width);
+  mix(key.height);
+  for (const auto V : key.placementsH)
+    mix(V);
+  for (const auto V : key.placementsV)
+    mix(V);
+  mix(key.monitorScale);
+  mix(key.frame);
+  return h;
+}
+
+SP<CTexture> CBorderTextureCache::get(const SBorderTheme &theme,
+                                      const SThemeVariant *variant,
+                                      const SBorderStyle &style,
+                                      const SBorderInstance &instance,
+                                      float monitorScale) {
+  static auto *const PCACHESIZE =
+      (Hyprlang::INT *const *)HyprlandAPI::getConfigValue(
+          PHANDLE, "plugin:imgborders:cache_size")
+          ->getDataStaticPtr();
+
+  const auto &ATLAS = variant ? variant->atlas : theme.atlas;
+  if (!ATLAS)
+    return nullptr;
+
+  const SComposedKey KEY = {
+      .atlas = ATLAS.get(),
+      .style = style,
+      .width = instance.box.width,
+      .height = instance.box.height,
+      .placementsH = instance.placementsH,
+      .placementsV = instance.placementsV,
+      .monitorScale = monitorScale,
+      .frame = instance.frame,
+  };
+
+  if (const auto IT = m_index.find(KEY); IT != m_index.end()) {
+    const auto ENTRY = IT->second;
+    if (ENTRY->atlas.lock() == ATLAS) {
+      m_entries.splice(m_entries.begin(), m_entries, ENTRY);
+      m_hits++;
+      return ENTRY->tex;
+    }
+
+    m_bytes -= ENTRY->bytes;
+    m_entries.erase(ENTRY);
+    m_index.erase(IT);
+  }
+
+  m_misses++;
+
+  const size_t BUDGET = (size_t)std::max<Hyprlang::INT>(0, **PCACHESIZE) << 20;
+  const Vector2D SIZE = {std::ceil(instance.box.width * monitorScale),
+                         std::ceil(instance.box.height * monitorScale)};
+  const size_t BYTES = (size_t)SIZE.x * (size_t)SIZE.y * (theme.hdr ? 8 : 4);
+  if (BYTES > BUDGET)
+    return nullptr;
+
+  auto tex = compose(theme, variant, style, instance, monitorScale, SIZE);
+  if (!tex)
+    return nullptr;
+
+  evict(BUDGET - BYTES);
+
+  m_entries.push_front({
+      .key = KEY,
+      .atlas = ATLAS,
+      .tex = tex,
+      .bytes = BYTES,
+  });
+  m_index[KEY] = m_entries.begin();
+  m_bytes += BYTES;
+
+  return tex;
+}
+
+void CBorderTextureCache::dropExpired() {
+  for (auto it = m_entries.begin(); it != m_entries.end();) {
+    if (!it->atlas.expired()) {
+      ++it;
+      continue;
+    }
+    m_bytes -= it->bytes;
+    m_index.erase(it->key);
+    it = m_entries.erase(it);
+  }
+}
+
+void CBorderTextureCache::evict(size_t budget) {
+  // Textures of themes that are gone go first, whatever their age
+  dropExpired();
+
+  while (m_bytes > budget && !m_entries.empty()) {
+    const auto &LAST = m_entries.back();
+    m_bytes -= LAST.bytes;
+    m_index.erase(LAST.key);
+    m_entries.pop_back();
+  }
+}
+
+SP<CTexture> CBorderTextureCache::compose(const SBorderTheme &theme,
+                                          const SThemeVariant *variant,
+                                          const SBorderStyle &style,
+                                          const SBorderInstance &instance,
+                                          float monitorScale,
+                                          const Vector2D &size) {
+  auto &shader = g_pGlobalState->shader;
+  if (!shader.ensureCompiled())
+    return nullptr;
+
+  auto tex = makeShared<CTexture>();
+  tex->allocate();
+  tex->m_size = size;
+
+  glBindTexture(GL_TEXTURE_2D, tex->m_texID);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  // Same precision as the theme, so HDR themes don't band once cached
+  glTexImage2D(GL_TEXTURE_2D, 0, theme.hdr ? GL_RGBA16F : GL_RGBA8, size.x,
+               size.y, 0, GL_RGBA, theme.hdr ? GL_HALF_FLOAT : GL_UNSIGNED_BYTE,
+               nullptr);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  // We're in the middle of a frame, put everything back afterwards
+  GLint prevFb = 0;
+  GLint prevViewport[4] = {};
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFb);
+  glGetIntegerv(GL_VIEWPORT, prevViewport);
+
+  GLuint fbo = 0;
+  glGenFramebuffers(1, &fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         tex->m_texID, 0);
+
+  const bool COMPLETE =
+      glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+  if (COMPLETE) {
+    g_pHyprOpenGL->scissor(nullptr);
+    glViewport(0, 0, size.x, size.y);
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    // Opacity is applied when the texture is drawn
+    auto opaque = instance;
+    opaque.a = 1.F;
+    shader.drawOffscreen(theme, variant, style, opaque, monitorScale, size);
+  }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, prevFb);
+  glViewport(prevViewport[0], prevViewport[1], prevViewport[2],
+             prevViewport[3]);
+  glDeleteFramebuffers(1, &fbo);
+
+  return COMPLETE ? tex : nullptr;
+}
+
+void CBorderTextureCache::clear() {
+  m_entries.clear();
+  m_index.clear();
+  m_bytes = 0;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "BorderShader.hpp"
+#include <hyprland/src/render/Texture.hpp>
+#include <list>
+#include <unordered_map>
+
+struct SBorderTheme;
+struct SThemeVariant;
+
+// What a composed border looks like. Windows of the same size with the same
+// theme and style end up with the same key and share the texture.
+struct SComposedKey {
+  CTexture *atlas = nullptr;
+  SBorderStyle style;
+  double width = 0;
+  double height = 0;
+  std::array<float, 4> placementsH = {};
+  std::array<float, 4> placementsV = {};
+  float monitorScale = 1.F;
+  // Of the focused or unfocused look
+  float frame = 0;
+
+  bool operator==(const SComposedKey &) const = default;
+};
+
+struct SComposedKeyHash {
+  size_t operator()(const SComposedKey &key) const;
+};
+
+// Whole borders rendered once into textures, so a border that doesn't change
+// is drawn as a single textured quad. Least recently used textures are freed
+// once the total goes over plugin:imgborders:cache_size.
+class CBorderTextureCache {
+public:
+  // Returns the composed border for instance, rendered at monitorScale from
+  // variant if there is one. It's the scaled box rounded up to whole pixels,
+  // with the border at its exact size in the top left. Null if it can't be
+  // cached. Needs the render context current.
+  SP<CTexture> get(const SBorderTheme &theme, const SThemeVariant *variant,
+                   const SBorderStyle &style, const SBorderInstance &instance,
+                   float monitorScale);
+
+  void clear();
+
+  // Frees the textures of themes that are gone. Needs the render context
+  // current.
+  void dropExpired();
+
+  size_t size() const { return m_entries.size(); }
+
+  uint64_t m_hits = 0;
+  uint64_t m_misses = 0;
+  size_t m_bytes = 0;
+
+private:
+  struct SEntry {
+    SComposedKey key;
+    // Guards against a new atlas reusing the address of a freed one. The
+    // variant's, if it was drawn from one.
+    WP<CTexture> atlas;
+    SP<CTexture> tex;
+    size_t bytes = 0;
+  };
+
+  SP<CTexture> compose(const SBorderTheme &theme,
+                       const SThemeVariant *variant,
+                       const SBorderStyle &style,
+                       const SBorderInstance &instance, float monitorScale,
+                       const Vector2D &size);
+
+  void evict(size_t budget);
+
+  // Most recently used first
+  std::list<SEntry> m_entries;
+  std::unordered_map<SComposedKey, std::list<SEntry>::iterator,
+                     SComposedKeyHash>
+      m_index;
+};
@@ -0,0 +1,167 @@
+#include "BorderLayout.hpp"
+#include <algorithm>
+#include <cmath>
+
+void BorderLayout::SBatch::resize(size_t count_) {
+  count = count_;
+  width.resize(count);
+  height.resize(count);
+  placements.resize(EDGES * 2 * count);
+  x.resize(SECTIONS * count);
+  y.resize(SECTIONS * count);
+  w.resize(SECTIONS * count);
+  h.resize(SECTIONS * count);
+  drawable.resize(count);
+}
+
+bool BorderLayout::validParams(const SParams &params) {
+  const auto OK = [](float v) { return std::isfinite(v) && v >= 0.F; };
+  return std::ranges::all_of(params.borders, OK) &&
+         std::ranges::all_of(params.customLengths, OK) &&
+         std::ranges::all_of(params.placements,
+                             [](float v) { return std::isfinite(v); });
+}
+
+// Kernels take their arrays as __restrict parameters, otherwise the compiler
+// only vectorizes them behind more alias checks than it's willing to emit.
+
+static void layoutCorners(size_t n, const std::array<float, 4> &borders,
+                          const float *__restrict width,
+                          const float *__restrict height,
+                          float *__restrict x, float *__restrict y,
+                          float *__restrict w, float *__restrict h) {
+  const auto [L, R, T, B] = borders;
+  const auto next = [&] {
+    x += n;
+    y += n;
+    w += n;
+    h += n;
+  };
+
+  // One loop per corner, top left, top right, bottom right, bottom left
+  for (size_t i = 0; i < n; i++) {
+    x[i] = 0.F;
+    y[i] = 0.F;
+    w[i] = L;
+    h[i] = T;
+  }
+  next();
+  for (size_t i = 0; i < n; i++) {
+    x[i] = width[i] - R;
+    y[i] = 0.F;
+    w[i] = R;
+    h[i] = T;
+  }
+  next();
+  for (size_t i = 0; i < n; i++) {
+    x[i] = width[i] - R;
+    y[i] = height[i] - B;
+    w[i] = R;
+    h[i] = B;
+  }
+  next();
+  for (size_t i = 0; i < n; i++) {
+    x[i] = 0.F;
+    y[i] = height[i] - B;
+    w[i] = L;
+    h[i] = B;
+  }
+}
+
+// NaN sizes compare false, so they come out not drawable
+static void checkFits(size_t n, const std::array<float, 4> &borders,
+                      const float *__restrict width,
+                      const float *__restrict height,
+                      uint8_t *__restrict drawable) {
+  const auto [L, R, T, B] = borders;
+  for (size_t i = 0; i < n; i++)
+    drawable[i] = (width[i] - L - R > 0.F) & (height[i] - T - B > 0.F);
+}
+
+// Same split as the shader's sampleEdge: a pixel belongs to the last piece
+// starting at or before it, so pieces cut off the ones before them. Every
+// piece is clamped to the space between the corners. Edges go top, right,
+// bottom, left, one instantiation each so the loop has no branches.
+template <size_t EDGE>
+static void layoutEdge(size_t n, const BorderLayout::SParams &params,
+                       const float *__restrict width,
+                       const float *__restrict height, float *__restrict c1,
+                       float *__restrict c2, float *__restrict x,
+                       float *__restrict y, float *__restrict w,
+                       float *__restrict h) {
+  constexpr bool HORIZONTAL = EDGE % 2 == 0;
+  const auto [L, R, T, B] = params.borders;
+  const float PCT1 = params.placements[EDGE * 2] / 100.F;
+  const float PCT2 = params.placements[EDGE * 2 + 1] / 100.F;
+  const float LEN1 = params.customLengths[EDGE * 2];
+  const float LEN2 = params.customLengths[EDGE * 2 + 1];
+
+  for (size_t i = 0; i < n; i++) {
+    const float LEN = HORIZONTAL ? width[i] - L - R : height[i] - T - B;
+    c1[i] = PCT1 * LEN;
+    c2[i] = PCT2 * LEN;
+
+    const float STARTS[5] = {0.F, c1[i], c1[i] + LEN1, c2[i], c2[i] + LEN2};
+    // Back to front, each piece ends where the next to start after it does
+    float end = LEN;
+    for (size_t p = 5; p-- > 0;) {
+      const float START = std::max(0.F, std::min(STARTS[p], LEN));
+      const float SPAN =
+          std::max(0.F, std::max(0.F, std::min(end, LEN)) - START);
+      end = std::min(end, STARTS[p]);
+
+      const size_t AT = p * n + i;
+      if constexpr (EDGE == 0) {
+        x[AT] = L + START;
+        y[AT] = 0.F;
+        w[AT] = SPAN;
+        h[AT] = T;
+      } else if constexpr (EDGE == 1) {
+        x[AT] = width[i] - R;
+        y[AT] = T + START;
+        w[AT] = R;
+        h[AT] = SPAN;
+      } else if constexpr (EDGE == 2) {
+        x[AT] = L + START;
+        y[AT] = height[i] - B;
+        w[AT] = SPAN;
+        h[AT] = B;
+      } else {
+        x[AT] = 0.F;
+        y[AT] = T + START;
+        w[AT] = L;
+        h[AT] = SPAN;
+      }
+    }
+  }
+}
+
+template <size_t EDGE>
+static void layoutEdge(const BorderLayout::SParams &params,
+                       BorderLayout::SBatch &batch) {
+  const size_t N = batch.count;
+  const size_t FIRST = 4 + EDGE * 5;
+  layoutEdge<EDGE>(N, params, batch.width.data(), batch.height.data(),
+                   batch.placements.data() + EDGE * 2 * N,
+                   batch.placements.data() + (EDGE * 2 + 1) * N,
+                   batch.x.data() + FIRST * N, batch.y.data() + FIRST * N,
+                   batch.w.data() + FIRST * N, batch.h.data() + FIRST * N);
+}
+
+void BorderLayout::layout(const SParams &params, SBatch &batch) {
+  if (!validParams(params)) {
+    std::ranges::fill(batch.drawable, 0);
+    return;
+  }
+
+  const size_t N = batch.count;
+  checkFits(N, params.borders, batch.width.data(), batch.height.data(),
+            batch.drawable.data());
+  layoutCorners(N, params.borders, batch.width.data(), batch.height.data(),
+                batch.x.data(), batch.y.data(), batch.w.data(),
+                batch.h.data());
+  layoutEdge<0>(params, batch);
+  layoutEdge<1>(params, batch);
+  layoutEdge<2>(params, batch);
+  layoutEdge<3>(params, batch);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Where the sections of a border land, for many windows at once. Plain
+// floats in and out, no compositor or GL types, so it can be driven from the
+// benchmark as well as from CImgBorder.
+namespace BorderLayout {
+// Corners, then the 5 pieces of the top, right, bottom and left edges, the
+// same order as eBorderSection
+constexpr size_t SECTIONS = 24;
+constexpr size_t EDGES = 4;
+
+// What every window in a batch shares. Edges go top, right, bottom, left and
+// each has two custom pieces, c1 and c2.
+struct SParams {
+  // Left, right, top, bottom thickness in layout units
+  std::array<float, 4> borders = {};
+  // Percent of the edge between the corners each custom piece starts at,
+  // by edge then piece
+  std::array<float, EDGES * 2> placements = {};
+  // Length of each custom piece along its edge, in layout units
+  std::array<float, EDGES * 2> customLengths = {};
+};
+
+// Structure of arrays over count windows. Sections are stored section by
+// section, x[section * count + window], so every loop runs down contiguous
+// floats.
+struct SBatch {
+  size_t count = 0;
+
+  // In: size of each window's border box
+  std::vector<float> width;
+  std::vector<float> height;
+
+  // Out: where each custom piece starts along its edge, by edge then piece
+  // like SParams::placements, placements[(edge * 2 + piece) * count + window]
+  std::vector<float> placements;
+  // Out: section boxes relative to the border box, empty ones 0 wide or high
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> w;
+  std::vector<float> h;
+  // Out: 0 if the border doesn't fit the window, its sections mean nothing
+  std::vector<uint8_t> drawable;
+
+  // Keeps the capacity, so relaying out the same windows doesn't allocate
+  void resize(size_t count);
+};
+
+// Whether borders and custom lengths are finite and not negative, and
+// placements finite
+bool validParams(const SParams &params);
+
+// Fills the outputs of batch from its sizes. Borders that are negative or
+// not finite leave nothing drawable.
+void layout(const SParams &params, SBatch &batch);
+} // namespace BorderLayout
@@ -0,0 +1,91 @@
+#include "BorderManager.hpp"
+#include "ImgBorder.hpp"
+#include "globals.hpp"
+#include <algorithm>
+#include <hyprland/src/Compositor.hpp>
+#include <hyprland/src/desktop/Window.hpp>
+#include <hyprland/src/plugins/PluginAPI.hpp>
+
+void CBorderManager::add(PHLWINDOW window) {
+  if (m_index.contains(window.get()))
+    return;
+
+  auto border = makeUnique<CImgBorder>(window);
+  border->m_slot = m_slots.size();
+  m_slots.push_back({.border = border.get(), .window = window.get()});
+  m_index[window.get()] = border->m_slot;
+
+  // Focused before the plugin loaded or the border was made, so no focus
+  // change told us. The next one has to redraw it.
+  if (window == g_pCompositor->m_lastWindow.lock())
+    m_focused = window.get();
+
+  HyprlandAPI::addWindowDecoration(PHANDLE, window, std::move(border));
+}
+
+void CBorderManager::removeFrom(PHLWINDOW window) {
+  // We could use the API but this is faster + it doesn't matter here that much.
+  if (const auto BORDER = get(window))
+    window->removeWindowDeco(BORDER);
+}
+
+CImgBorder *CBorderManager::get(const PHLWINDOW &window) const {
+  const auto IT = m_index.find(window.get());
+  return IT == m_index.end() ? nullptr : m_slots[IT->second].border;
+}
+
+void CBorderManager::unregister(CImgBorder *border) {
+  const size_t SLOT = border->m_slot;
+  if (SLOT >= m_slots.size() || m_slots[SLOT].border != border)
+    return;
+
+  m_index.erase(m_slots[SLOT].window);
+  if (m_slots[SLOT].window == m_focused)
+    m_focused = nullptr;
+
+  if (SLOT != m_slots.size() - 1) {
+    m_slots[SLOT] = m_slots.back();
+    m_slots[SLOT].border->m_slot = SLOT;
+    m_index[m_slots[SLOT].window] = SLOT;
+  }
+  m_slots.pop_back();
+}
+
+void CBorderManager::applyConfig(const SP<const SConfigSnapshot> &config) {
+  for (const auto &SLOT : m_slots)
+    SLOT.border->applyConfig(config);
+  damageAll();
+}
+
+void CBorderManager::damageAll() {
+  for (const auto &SLOT : m_slots)
+    SLOT.border->damageEntire();
+}
+
+void CBorderManager::onFocusChanged(const PHLWINDOW &window) {
+  for (const auto *W : {m_focused, (const CWindow *)window.get()}) {
+    if (const auto IT = m_index.find(W); IT != m_index.end())
+      m_slots[IT->second].border->onFocusChanged();
+  }
+  m_focused = window.get();
+}
+
+void CBorderManager::onThemeReady(const SP<SBorderTheme> &theme) {
+  for (const auto &SLOT : m_slots)
+    SLOT.border->onThemeReady(theme);
+}
+
+float CBorderManager::animate(std::chrono::steady_clock::time_point now) {
+  float fps = 0.F;
+  for (const auto &SLOT : m_slots)
+    fps = std::max(fps, SLOT.border->animate(now));
+  return fps;
+}
+
+bool CBorderManager::releaseIdle(std::chrono::steady_clock::time_point now,
+                                 std::chrono::seconds idle) {
+  bool released = false;
+  for (const auto &SLOT : m_slots)
+    released |= SLOT.border->releaseIfIdle(now, idle);
+  return released;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <hyprland/src/desktop/DesktopTypes.hpp>
+#include <unordered_map>
+#include <vector>
+
+class CImgBorder;
+struct SBorderTheme;
+struct SConfigSnapshot;
+
+// Every border, indexed by the window it decorates. Borders are owned by
+// their windows and unregister themselves when destroyed, so adding,
+// finding and removing one costs the same with 10 or 1000 windows open.
+class CBorderManager {
+public:
+  // Gives window a border, unless it already has one
+  void add(PHLWINDOW window);
+
+  // Takes the border off window, if it has one
+  void removeFrom(PHLWINDOW window);
+
+  // The border of window, null if it has none
+  CImgBorder *get(const PHLWINDOW &window) const;
+
+  // Called by the border as it's destroyed
+  void unregister(CImgBorder *border);
+
+  // Moves every border to config, see CImgBorder::applyConfig
+  void applyConfig(const SP<const SConfigSnapshot> &config);
+
+  void damageAll();
+
+  // Damages the borders of the window losing focus and of window, the one
+  // gaining it, if they look different focused. Window may be null.
+  void onFocusChanged(const PHLWINDOW &window);
+
+  // See CImgBorder::onThemeReady
+  void onThemeReady(const SP<SBorderTheme> &theme);
+
+  // See CImgBorder::releaseIfIdle. Whether any border released its theme.
+  bool releaseIdle(std::chrono::steady_clock::time_point now,
+                   std::chrono::seconds idle);
+
+  // See CImgBorder::animate. The highest frame rate of any border, 0 if
+  // none is animating.
+  float animate(std::chrono::steady_clock::time_point now);
+
+  template <typename F> void forEach(F &&fn) const {
+    for (const auto &SLOT : m_slots)
+      fn(*SLOT.border);
+  }
+
+  size_t size() const { return m_slots.size(); }
+
+private:
+  struct SSlot {
+    CImgBorder *border = nullptr;
+    // Only a key, the window may already be gone when its border is
+    const CWindow *window = nullptr;
+  };
+
+  // Packed, removal moves the last slot into the hole
+  std::vector<SSlot> m_slots;
+  std::unordered_map<const CWindow *, size_t> m_index;
+  // Only a key, like in SSlot. Seeded as borders are added, then followed
+  // through onFocusChanged.
+  const CWindow *m_focused = nullptr;
+};
@@ -0,0 +1,172 @@
+#include "BorderProgram.hpp"
+#include "BorderShaderSource.hpp"
+#include <format>
+
+static GLuint compileShader(GLenum type, const char *src, std::string &error) {
+  const auto SHADER = glCreateShader(type);
+  glShaderSource(SHADER, 1, &src, nullptr);
+  glCompileShader(SHADER);
+
+  GLint ok = GL_FALSE;
+  glGetShaderiv(SHADER, GL_COMPILE_STATUS, &ok);
+  if (ok != GL_TRUE) {
+    char log[1024] = {0};
+    glGetShaderInfoLog(SHADER, sizeof(log), nullptr, log);
+    error = std::format("failed to compile: {}", log);
+    glDeleteShader(SHADER);
+    return 0;
+  }
+
+  return SHADER;
+}
+
+bool BorderProgram::create(SProgram &out, std::string &error) {
+  const auto VERT =
+      compileShader(GL_VERTEX_SHADER, BorderShaderSource::VERT, error);
+  const auto FRAG =
+      VERT ? compileShader(GL_FRAGMENT_SHADER, BorderShaderSource::FRAG, error)
+           : 0;
+
+  if (VERT && FRAG) {
+    out.program = glCreateProgram();
+    glAttachShader(out.program, VERT);
+    glAttachShader(out.program, FRAG);
+    glLinkProgram(out.program);
+
+    GLint ok = GL_FALSE;
+    glGetProgramiv(out.program, GL_LINK_STATUS, &ok);
+    if (ok != GL_TRUE) {
+      char log[1024] = {0};
+      glGetProgramInfoLog(out.program, sizeof(log), nullptr, log);
+      error = std::format("failed to link: {}", log);
+      glDeleteProgram(out.program);
+      out.program = 0;
+    }
+  }
+
+  if (VERT)
+    glDeleteShader(VERT);
+  if (FRAG)
+    glDeleteShader(FRAG);
+
+  if (!out.program)
+    return false;
+
+  auto &u = out.uniforms;
+  u.proj = glGetUniformLocation(out.program, "proj");
+  u.tex = glGetUniformLocation(out.program, "tex");
+  u.texSize = glGetUniformLocation(out.program, "texSize");
+  u.borders = glGetUniformLocation(out.program, "borders");
+  u.scale = glGetUniformLocation(out.program, "scale");
+  u.sections = glGetUniformLocation(out.program, "sections");
+  u.lengths = glGetUniformLocation(out.program, "lengths");
+  u.drawMask = glGetUniformLocation(out.program, "drawMask");
+  u.gutter = glGetUniformLocation(out.program, "gutter");
+  u.frameHeight = glGetUniformLocation(out.program, "frameHeight");
+
+  // Per-instance attributes, the quad itself comes from gl_VertexID
+  glGenVertexArrays(1, &out.vao);
+  glGenBuffers(1, &out.instanceVbo);
+  glBindVertexArray(out.vao);
+  glBindBuffer(GL_ARRAY_BUFFER, out.instanceVbo);
+
+  const GLsizei STRIDE = BorderShaderSource::INSTANCE_FLOATS * sizeof(float);
+  size_t offset = 0;
+  for (const auto &[LOC, COUNT] : BorderShaderSource::ATTRIBS) {
+    glEnableVertexAttribArray(LOC);
+    glVertexAttribPointer(LOC, COUNT, GL_FLOAT, GL_FALSE, STRIDE,
+                          (const void *)(offset * sizeof(float)));
+    glVertexAttribDivisor(LOC, 1);
+    offset += COUNT;
+  }
+
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  return true;
+}
+
+void BorderProgram::destroy(SProgram &program) {
+  if (program.instanceVbo)
+    glDeleteBuffers(1, &program.instanceVbo);
+  if (program.vao)
+    glDeleteVertexArrays(1, &program.vao);
+  if (program.program)
+    glDeleteProgram(program.program);
+
+  program.instanceVbo = 0;
+  program.vao = 0;
+  program.program = 0;
+}
+
+void BorderProgram::pack(const SBorderInstance &instance, const CBox &box,
+                         std::vector<float> &out) {
+  out.insert(out.end(),
+             {(float)box.x, (float)box.y, (float)box.width, (float)box.height,
+              (float)instance.box.width, (float)instance.box.height});
+  out.insert(out.end(), instance.placementsH.begin(),
+             instance.placementsH.end());
+  out.insert(out.end(), instance.placementsV.begin(),
+             instance.placementsV.end());
+  out.push_back(instance.a);
+  out.push_back(instance.frame);
+}
+
+void BorderProgram::bind(const SProgram &program, const SBorderTheme &theme,
+                         const SThemeVariant *variant,
+                         const SBorderStyle &style,
+                         const std::array<float, 9> &proj, GLuint tex,
+                         const Vector2D &texSize) {
+  const auto &SECTIONS = variant ? variant->sections : theme.sections;
+
+  std::array<float, SECTION_COUNT * 4> sections;
+  std::array<float, SECTION_COUNT * 2> lengths;
+  for (size_t i = 0; i < SECTION_COUNT; i++) {
+    const auto &SEC = SECTIONS[i];
+    sections[i * 4 + 0] = SEC.x;
+    sections[i * 4 + 1] = SEC.y;
+    sections[i * 4 + 2] = SEC.width;
+    sections[i * 4 + 3] = SEC.height;
+    lengths[i * 2 + 0] = theme.sections[i].width;
+    lengths[i * 2 + 1] = theme.sections[i].height;
+  }
+
+  const auto &U = program.uniforms;
+  glUniformMatrix3fv(U.proj, 1, GL_TRUE, proj.data());
+  glUniform2f(U.texSize, texSize.x, texSize.y);
+  glUniform4fv(U.borders, 1, style.borders.data());
+  glUniform1f(U.scale, style.scale);
+  glUniform4fv(U.sections, SECTION_COUNT, sections.data());
+  glUniform2fv(U.lengths, SECTION_COUNT, lengths.data());
+  glUniform1i(U.tex, 0);
+  glUniform1i(U.drawMask, theme.opaqueMask | theme.mixedMask);
+  glUniform1f(U.gutter, variant ? variant->gutter : theme.gutter);
+  glUniform1f(U.frameHeight, theme.frameHeight);
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, tex);
+  const GLint FILTER = style.smooth ? GL_LINEAR : GL_NEAREST;
+  // Trilinear when shrinking, so thin lines don't shimmer
+  const GLint MINFILTER = style.smooth && !variant && theme.mipLevels > 0
+                              ? GL_LINEAR_MIPMAP_LINEAR
+                              : FILTER;
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, FILTER);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, MINFILTER);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+  glBindVertexArray(program.vao);
+  glBindBuffer(GL_ARRAY_BUFFER, program.instanceVbo);
+}
+
+void BorderProgram::upload(const float *instances, size_t count) {
+  glBufferData(GL_ARRAY_BUFFER,
+               count * BorderShaderSource::INSTANCE_FLOATS * sizeof(float),
+               instances, GL_STREAM_DRAW);
+}
+
+void BorderProgram::unbind() {
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
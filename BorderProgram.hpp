@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Theme.hpp"
+#include <GLES3/gl32.h>
+#include <array>
+#include <string>
+#include <vector>
+
+// How a theme is put on screen. Shared by every border in one draw.
+struct SBorderStyle {
+  std::array<float, 4> borders = {}; // left, right, top, bottom
+  float scale = 1.F;
+  bool smooth = true;
+
+  bool operator==(const SBorderStyle &) const = default;
+};
+
+// Where one window's border goes and how its edges are laid out. All values
+// are in layout units, the box relative to its monitor. Placements are
+// measured from the start of their edge.
+struct SBorderInstance {
+  CBox box;
+  std::array<float, 4> placementsH = {}; // top c1, top c2, bottom c1, bottom c2
+  std::array<float, 4> placementsV = {}; // right c1, right c2, left c1, left c2
+  float a = 1.F;
+  // Of an animated theme, 0 for still ones
+  float frame = 0;
+};
+
+// The border shader's GL objects and how instances and uniforms are fed to
+// them, with no compositor state involved. CBorderShader draws through it in
+// the plugin and the benchmark in bench/ does the same outside of it.
+namespace BorderProgram {
+struct SProgram {
+  GLuint program = 0;
+  GLuint vao = 0;
+  GLuint instanceVbo = 0;
+
+  struct {
+    GLint proj = -1;
+    GLint tex = -1;
+    GLint texSize = -1;
+    GLint borders = -1;
+    GLint scale = -1;
+    GLint sections = -1;
+    GLint lengths = -1;
+    GLint drawMask = -1;
+    GLint gutter = -1;
+    GLint frameHeight = -1;
+  } uniforms;
+};
+
+// Compiles and links BorderShaderSource and sets up the per-instance
+// attributes. On failure nothing is left behind and error says why.
+bool create(SProgram &out, std::string &error);
+
+void destroy(SProgram &program);
+
+// Appends an instance drawn at box, in pixels, laid out at the size of
+// instance.box
+void pack(const SBorderInstance &instance, const CBox &box,
+          std::vector<float> &out);
+
+// Sets the uniforms for drawing theme, or variant if given, from the atlas
+// texture tex of size texSize, and binds it with the instance buffer. proj
+// is row major. The program has to be in use already.
+void bind(const SProgram &program, const SBorderTheme &theme,
+          const SThemeVariant *variant, const SBorderStyle &style,
+          const std::array<float, 9> &proj, GLuint tex,
+          const Vector2D &texSize);
+
+// Fills the bound instance buffer with count packed instances
+void upload(const float *instances, size_t count);
+
+void unbind();
+} // namespace BorderProgram
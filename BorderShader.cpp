@@ -0,0 +1,140 @@
+#include "BorderShader.hpp"
+#include "BorderProgram.hpp"
+#include "BorderShaderSource.hpp"
+#include "ThemeCache.hpp"
+#include "globals.hpp"
+#include <hyprland/src/debug/Log.hpp>
+#include <hyprland/src/plugins/PluginAPI.hpp>
+#include <hyprland/src/render/OpenGL.hpp>
+
+CBorderShader::~CBorderShader() { destroy(); }
+
+bool CBorderShader::ensureCompiled() {
+  if (m_program.program)
+    return true;
+  if (m_failed)
+    return false;
+
+  std::string error;
+  if (!BorderProgram::create(m_program, error)) {
+    Debug::log(ERR, "[imgborders] border shader {}", error);
+    m_failed = true;
+    HyprlandAPI::addNotification(
+        PHANDLE,
+        "[imgborders] border shader failed to build, borders won't be drawn. "
+        "Check the log for details.",
+        CHyprColor{1.0, 0.1, 0.1, 1.0}, 5000);
+    return false;
+  }
+
+  return true;
+}
+
+void CBorderShader::bind(const SBorderTheme &theme,
+                         const SThemeVariant *variant,
+                         const SBorderStyle &style, const Mat3x3 &proj) {
+  const auto &ATLAS = variant ? variant->atlas : theme.atlas;
+
+  // Through Hyprland, which keeps track of the program in use
+  g_pHyprOpenGL->useProgram(m_program.program);
+  BorderProgram::bind(m_program, theme, variant, style, proj.getMatrix(),
+                      ATLAS->m_texID, ATLAS->m_size);
+  g_pHyprOpenGL->blend(true);
+
+  BorderProgram::upload(m_instanceData.data(),
+                        m_instanceData.size() /
+                            BorderShaderSource::INSTANCE_FLOATS);
+}
+
+void CBorderShader::draw(const SBorderTheme &theme,
+                         const SThemeVariant *variant,
+                         const SBorderStyle &style,
+                         const std::vector<SBorderInstance> &instances,
+                         float monitorScale, bool opaquePass) {
+  if (!m_program.program || !theme.atlas || instances.empty())
+    return;
+
+  // Nothing but transparent pixels
+  if (!(theme.opaqueMask | theme.mixedMask))
+    return;
+
+  auto &renderData = g_pHyprOpenGL->m_renderData;
+
+  // Pack the instances, only drawing where one of them actually is
+  CRegion area;
+  m_instanceData.clear();
+  for (const auto &INSTANCE : instances) {
+    CBox box = INSTANCE.box;
+    box.scale(monitorScale);
+    renderData.renderModif.applyToBox(box);
+    area.add(box);
+    BorderProgram::pack(INSTANCE, box, m_instanceData);
+  }
+
+  CRegion damage = renderData.damage.copy().intersect(area);
+  if (renderData.clipBox.width != 0 && renderData.clipBox.height != 0)
+    damage.intersect(renderData.clipBox);
+  if (damage.empty())
+    return;
+
+  bind(theme, variant, style,
+       renderData.projection.copy().multiply(renderData.monitorProjection));
+
+  // Fully opaque sections can overwrite whatever is below them
+  std::vector<std::pair<uint32_t, bool>> passes;
+  if (opaquePass && theme.opaqueMask)
+    passes = {{theme.opaqueMask, false}, {theme.mixedMask, true}};
+  else
+    passes = {{theme.opaqueMask | theme.mixedMask, true}};
+
+  const auto COUNT = (GLsizei)instances.size();
+  uint64_t draws = 0;
+  for (const auto &[MASK, BLEND] : passes) {
+    if (!MASK)
+      continue;
+
+    glUniform1i(m_program.uniforms.drawMask, MASK);
+    g_pHyprOpenGL->blend(BLEND);
+    damage.forEachRect([COUNT, &draws](const auto &RECT) {
+      g_pHyprOpenGL->scissor(&RECT);
+      glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, COUNT);
+      draws++;
+    });
+  }
+  g_pGlobalState->stats.countDraws(draws);
+  g_pHyprOpenGL->scissor(nullptr);
+  g_pHyprOpenGL->blend(true);
+
+  BorderProgram::unbind();
+}
+
+void CBorderShader::drawOffscreen(const SBorderTheme &theme,
+                                  const SThemeVariant *variant,
+                                  const SBorderStyle &style,
+                                  const SBorderInstance &instance, float scale,
+                                  const Vector2D &size) {
+  if (!m_program.program || !theme.atlas)
+    return;
+
+  m_instanceData.clear();
+  // At its fractional size, the last row and column of the target may be
+  // partly covered like they'd be on screen
+  BorderProgram::pack(instance,
+                      CBox{Vector2D{}, instance.box.size() * scale},
+                      m_instanceData);
+
+  // Row 0 of the target ends up at the top of the border, like an image
+  // uploaded from memory
+  const Mat3x3 PROJ(std::array<float, 9>{
+      2.F / (float)size.x, 0.F, -1.F, //
+      0.F, 2.F / (float)size.y, -1.F, //
+      0.F, 0.F, 1.F,                  //
+  });
+
+  bind(theme, variant, style, PROJ);
+  glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, 1);
+  g_pGlobalState->stats.countDraws(1);
+  BorderProgram::unbind();
+}
+
+void CBorderShader::destroy() { BorderProgram::destroy(m_program); }
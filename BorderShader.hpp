@@ -0,0 +1,45 @@
+#pragma once
+
+#include "BorderProgram.hpp"
+#include <hyprland/src/helpers/math/Math.hpp>
+#include <vector>
+
+// Draws whole borders (corners, custom pieces and tiled runs) sampling every
+// section straight from the theme's atlas, one instance per window.
+class CBorderShader {
+public:
+  ~CBorderShader();
+
+  // Compiles on first use, so it has to be called with the render context
+  // current. Returns false if the program is unusable.
+  bool ensureCompiled();
+
+  // Samples variant instead of the theme's atlas when given one. With
+  // opaquePass, fully opaque sections are drawn first without blending. Only
+  // safe when the instances don't overlap and aren't faded.
+  void draw(const SBorderTheme &theme, const SThemeVariant *variant,
+            const SBorderStyle &style,
+            const std::vector<SBorderInstance> &instances, float monitorScale,
+            bool opaquePass = false);
+
+  // Draws one border at scale into the top left of a size sized viewport of
+  // the bound framebuffer, ignoring where its box is. Nothing is clipped to
+  // damage.
+  void drawOffscreen(const SBorderTheme &theme, const SThemeVariant *variant,
+                     const SBorderStyle &style,
+                     const SBorderInstance &instance, float scale,
+                     const Vector2D &size);
+
+  void destroy();
+
+private:
+  // Sets up program, atlas and the packed instances for drawing
+  void bind(const SBorderTheme &theme, const SThemeVariant *variant,
+            const SBorderStyle &style, const Mat3x3 &proj);
+
+  BorderProgram::SProgram m_program;
+  bool m_failed = false;
+
+  // Reused between draws so packing doesn't allocate every frame
+  std::vector<float> m_instanceData;
+};
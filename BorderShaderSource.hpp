@@ -0,0 +1,190 @@
+#pragma once
+
+#include <GLES3/gl32.h>
+#include <array>
+#include <cstddef>
+#include <utility>
+
+// GLSL and instance layout of the border shader. Apart from CBorderShader so
+// the benchmark in bench/ draws with the very same program.
+namespace BorderShaderSource {
+// One instance per window. The quad is generated from gl_VertexID, 'box' is
+// where the border lands on screen and 'size' the size it was laid out at
+// (they only differ while a render modifier scales things).
+inline constexpr const char *VERT = R"glsl(#version 300 es
+precision highp float;
+
+uniform mat3 proj;
+
+layout(location = 0) in vec4 box;
+layout(location = 1) in vec2 size;
+layout(location = 2) in vec4 placementsH;
+layout(location = 3) in vec4 placementsV;
+layout(location = 4) in float alpha;
+layout(location = 5) in float frame;
+
+out vec2 v_local;
+flat out vec2 v_size;
+flat out vec2 v_step;
+flat out vec4 v_placementsH;
+flat out vec4 v_placementsV;
+flat out float v_alpha;
+flat out float v_frame;
+
+void main() {
+  vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+  v_local = corner * size;
+  v_size = size;
+  v_step = size / box.zw;
+  v_placementsH = placementsH;
+  v_placementsV = placementsV;
+  v_alpha = alpha;
+  v_frame = frame;
+  gl_Position = vec4(proj * vec3(box.xy + corner * box.zw, 1.0), 1.0);
+}
+)glsl";
+
+// Works out which of the 24 sections a pixel belongs to, and where inside it.
+// Tiled runs repeat from their own start, like GL_REPEAT did on the slices.
+inline constexpr const char *FRAG = R"glsl(#version 300 es
+precision highp float;
+
+in vec2 v_local;
+flat in vec2 v_size;
+flat in vec2 v_step; // layout units per pixel on screen
+flat in vec4 v_placementsH; // top c1, top c2, bottom c1, bottom c2
+flat in vec4 v_placementsV; // right c1, right c2, left c1, left c2
+flat in float v_alpha;
+flat in float v_frame;
+
+uniform sampler2D tex;
+uniform vec2 texSize;
+uniform vec4 borders; // left, right, top, bottom
+uniform float scale;
+uniform vec4 sections[24];
+uniform vec2 lengths[24]; // section sizes in the image, layout goes by them
+uniform float gutter; // padding around each section in a mipmapped atlas
+uniform float frameHeight; // frames sit this far apart, below each other
+uniform int drawMask; // bit per section, the rest is left to another pass
+
+layout(location = 0) out vec4 fragColor;
+
+// p is 0..1 inside the section, which is 'extent' layout units big. Stays
+// half a texel inside the section and its gutter so linear filtering can't
+// pull in its neighbours. Gradients are worked out from the extent, the
+// wrapping in tiled runs would throw off the implicit ones.
+vec4 sampleSection(int i, vec2 p, vec2 extent) {
+  vec4 r = sections[i];
+  if (r.z <= 0.0 || r.w <= 0.0 || (drawMask & (1 << i)) == 0)
+    discard;
+
+  vec2 inset = vec2(0.5 - gutter);
+  vec2 px = clamp(r.xy + p * r.zw, r.xy + inset, r.xy + r.zw - inset);
+  px.y += v_frame * frameHeight;
+  vec2 texels = r.zw / extent * v_step / texSize;
+  return textureGrad(tex, px / texSize, vec2(texels.x, 0.0),
+                     vec2(0.0, texels.y));
+}
+
+float sectionLength(int i, bool horizontal) {
+  return (horizontal ? lengths[i].x : lengths[i].y) * scale;
+}
+
+// 'along' runs from the start of the edge, 'across' is 0..1 through its
+// thickness. Sections are checked in reverse draw order so overlapping pieces
+// stack the same way they did when drawn one by one.
+vec4 sampleEdge(int first, float along, float across, float thickness,
+                float c1, float c2, bool horizontal) {
+  float c1Len = sectionLength(first + 1, horizontal);
+  float c2Len = sectionLength(first + 3, horizontal);
+
+  int idx;
+  float start;
+  if (along >= c2 + c2Len) {
+    idx = first + 4;
+    start = c2 + c2Len;
+  } else if (along >= c2) {
+    idx = first + 3;
+    start = c2;
+  } else if (along >= c1 + c1Len) {
+    idx = first + 2;
+    start = c1 + c1Len;
+  } else if (along >= c1) {
+    idx = first + 1;
+    start = c1;
+  } else {
+    idx = first;
+    start = 0.0;
+  }
+
+  float len = sectionLength(idx, horizontal);
+  if (len <= 0.0)
+    discard;
+
+  float t = (along - start) / len;
+  if (idx != first + 1 && idx != first + 3)
+    t = fract(t);
+
+  return sampleSection(idx, horizontal ? vec2(t, across) : vec2(across, t),
+                       horizontal ? vec2(len, thickness)
+                                  : vec2(thickness, len));
+}
+
+void main() {
+  vec2 p = v_local;
+  vec2 size = v_size;
+  float L = borders.x;
+  float R = borders.y;
+  float T = borders.z;
+  float B = borders.w;
+
+  bool left = p.x < L;
+  bool right = p.x >= size.x - R;
+  bool top = p.y < T;
+  bool bottom = p.y >= size.y - B;
+
+  vec4 pix;
+  if (top && left)
+    pix = sampleSection(0, p / vec2(L, T), vec2(L, T));
+  else if (top && right)
+    pix = sampleSection(1, vec2((p.x - size.x + R) / R, p.y / T), vec2(R, T));
+  else if (bottom && right)
+    pix = sampleSection(2, (p - size + vec2(R, B)) / vec2(R, B), vec2(R, B));
+  else if (bottom && left)
+    pix = sampleSection(3, vec2(p.x / L, (p.y - size.y + B) / B), vec2(L, B));
+  else if (top)
+    pix = sampleEdge(4, p.x - L, p.y / T, T, v_placementsH.x, v_placementsH.y,
+                     true);
+  else if (right)
+    pix = sampleEdge(9, p.y - T, (p.x - size.x + R) / R, R, v_placementsV.x,
+                     v_placementsV.y, false);
+  else if (bottom)
+    pix = sampleEdge(14, p.x - L, (p.y - size.y + B) / B, B, v_placementsH.z,
+                     v_placementsH.w, true);
+  else if (left)
+    pix = sampleEdge(19, p.y - T, p.x / L, L, v_placementsV.z,
+                     v_placementsV.w, false);
+  else
+    discard;
+
+  // Same as DISCARD_ALPHA with a 0.01 threshold
+  if (pix.a < 0.01)
+    discard;
+
+  fragColor = pix * v_alpha;
+}
+)glsl";
+
+// Per-instance attributes by location and float count, packed in this order
+inline constexpr std::array<std::pair<GLuint, GLint>, 6> ATTRIBS = {{
+    {0, 4}, // box
+    {1, 2}, // size
+    {2, 4}, // placementsH
+    {3, 4}, // placementsV
+    {4, 1}, // alpha
+    {5, 1}, // frame
+}};
+
+// box, size, placementsH, placementsV, alpha, frame
+inline constexpr size_t INSTANCE_FLOATS = 4 + 2 + 4 + 4 + 1 + 1;
+} // namespace BorderShaderSource
@@ -0,0 +1,261 @@
+#include "BorderStats.hpp"
+#include <EGL/egl.h>
+#include <GLES2/gl2ext.h>
+#include <algorithm>
+#include <bit>
+#include <format>
+#include <string_view>
+
+// By their eStatStage
+static constexpr std::array<const char *, STAT_COUNT> STAGE_NAMES = {
+    "draw", "drawGpu", "layout", "load", "slice", "upload", "reload",
+};
+
+// In flight at once. When the GPU falls this far behind, draws go untimed.
+constexpr size_t MAX_QUERIES = 64;
+
+static PFNGLGETQUERYOBJECTUI64VEXTPROC getQueryObjectui64v = nullptr;
+
+void CStatHistogram::record(uint64_t value) {
+  constexpr auto RELAXED = std::memory_order_relaxed;
+  const size_t BUCKET = std::min<size_t>(std::bit_width(value), BUCKETS - 1);
+  m_buckets[BUCKET].fetch_add(1, RELAXED);
+  m_count.fetch_add(1, RELAXED);
+  m_sum.fetch_add(value, RELAXED);
+  m_last.store(value, RELAXED);
+
+  auto max = m_max.load(RELAXED);
+  while (value > max && !m_max.compare_exchange_weak(max, value, RELAXED))
+    ;
+}
+
+void CStatHistogram::reset() {
+  for (auto &bucket : m_buckets)
+    bucket.store(0, std::memory_order_relaxed);
+  m_count.store(0, std::memory_order_relaxed);
+  m_sum.store(0, std::memory_order_relaxed);
+  m_max.store(0, std::memory_order_relaxed);
+  m_last.store(0, std::memory_order_relaxed);
+}
+
+uint64_t CStatHistogram::count() const {
+  return m_count.load(std::memory_order_relaxed);
+}
+
+uint64_t CStatHistogram::sum() const {
+  return m_sum.load(std::memory_order_relaxed);
+}
+
+uint64_t CStatHistogram::max() const {
+  return m_max.load(std::memory_order_relaxed);
+}
+
+uint64_t CStatHistogram::last() const {
+  return m_last.load(std::memory_order_relaxed);
+}
+
+uint64_t CStatHistogram::percentile(double p) const {
+  // Buckets may move on while they're summed, good enough for a report
+  uint64_t total = 0;
+  for (const auto &BUCKET : m_buckets)
+    total += BUCKET.load(std::memory_order_relaxed);
+  if (!total)
+    return 0;
+
+  const auto RANK = (uint64_t)std::max(1.0, p * (double)total);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < BUCKETS; i++) {
+    seen += m_buckets[i].load(std::memory_order_relaxed);
+    if (seen >= RANK)
+      return std::min(i ? (uint64_t)1 << i : 0, max());
+  }
+  return max();
+}
+
+void CBorderStats::setEnabled(bool enabled) {
+  m_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void CBorderStats::record(eStatStage stage, uint64_t ns) {
+  if (enabled())
+    m_stages[stage].record(ns);
+}
+
+void CBorderStats::countDraws(uint64_t draws) {
+  if (enabled())
+    m_draws.fetch_add(draws, std::memory_order_relaxed);
+}
+
+void CBorderStats::beginFrame() {
+  if (const auto DRAWS = m_draws.exchange(0, std::memory_order_relaxed))
+    m_frameDraws.record(DRAWS);
+
+  // Drained even while off, so the queries come back
+  if (!m_pendingQueries.empty())
+    collectGpuTimers();
+}
+
+bool CBorderStats::gpuTimersSupported() {
+  if (m_gpuTimers == GPU_TIMERS_UNKNOWN) {
+    const auto EXTENSIONS = (const char *)glGetString(GL_EXTENSIONS);
+    getQueryObjectui64v =
+        (PFNGLGETQUERYOBJECTUI64VEXTPROC)eglGetProcAddress(
+            "glGetQueryObjectui64vEXT");
+    const bool OK =
+        EXTENSIONS && getQueryObjectui64v &&
+        std::string_view(EXTENSIONS).contains("GL_EXT_disjoint_timer_query");
+    m_gpuTimers = OK ? GPU_TIMERS_OK : GPU_TIMERS_MISSING;
+  }
+  return m_gpuTimers == GPU_TIMERS_OK;
+}
+
+void CBorderStats::beginGpuTimer() {
+  if (!enabled() || m_activeQuery || !gpuTimersSupported())
+    return;
+
+  if (m_freeQueries.empty()) {
+    if (m_queries >= MAX_QUERIES)
+      return;
+    GLuint query = 0;
+    glGenQueries(1, &query);
+    m_freeQueries.push_back(query);
+    m_queries++;
+  }
+
+  m_activeQuery = m_freeQueries.back();
+  m_freeQueries.pop_back();
+  glBeginQuery(GL_TIME_ELAPSED_EXT, m_activeQuery);
+}
+
+void CBorderStats::endGpuTimer() {
+  if (!m_activeQuery)
+    return;
+
+  glEndQuery(GL_TIME_ELAPSED_EXT);
+  m_pendingQueries.push_back(m_activeQuery);
+  m_activeQuery = 0;
+}
+
+void CBorderStats::collectGpuTimers() {
+  // Something like a clock change made every result in flight meaningless
+  GLint disjoint = 0;
+  glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+  if (disjoint) {
+    m_freeQueries.insert(m_freeQueries.end(), m_pendingQueries.begin(),
+                         m_pendingQueries.end());
+    m_pendingQueries.clear();
+    return;
+  }
+
+  // They finish in order, the first one not done ends the search
+  while (!m_pendingQueries.empty()) {
+    const auto QUERY = m_pendingQueries.front();
+    GLuint available = 0;
+    glGetQueryObjectuiv(QUERY, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+      break;
+
+    GLuint64 ns = 0;
+    getQueryObjectui64v(QUERY, GL_QUERY_RESULT, &ns);
+    record(STAT_DRAW_GPU, ns);
+
+    m_pendingQueries.pop_front();
+    m_freeQueries.push_back(QUERY);
+  }
+}
+
+void CBorderStats::reset() {
+  for (auto &stage : m_stages)
+    stage.reset();
+  m_frameDraws.reset();
+  m_draws.store(0, std::memory_order_relaxed);
+}
+
+void CBorderStats::destroy() {
+  if (m_activeQuery)
+    endGpuTimer();
+
+  m_freeQueries.insert(m_freeQueries.end(), m_pendingQueries.begin(),
+                       m_pendingQueries.end());
+  m_pendingQueries.clear();
+  if (!m_freeQueries.empty())
+    glDeleteQueries((GLsizei)m_freeQueries.size(), m_freeQueries.data());
+  m_freeQueries.clear();
+  m_queries = 0;
+  m_gpuTimers = GPU_TIMERS_UNKNOWN;
+}
+
+static std::string histogramJson(const CStatHistogram &histogram,
+                                 std::string_view unit) {
+  const auto COUNT = histogram.count();
+  return std::format(
+      R"({{"count": {}, "total{}": {}, "mean{}": {}, "p50{}": {}, )"
+      R"("p90{}": {}, "p99{}": {}, "max{}": {}, "last{}": {}}})",
+      COUNT, unit, histogram.sum(), unit,
+      COUNT ? histogram.sum() / COUNT : 0, unit, histogram.percentile(0.5),
+      unit, histogram.percentile(0.9), unit, histogram.percentile(0.99), unit,
+      histogram.max(), unit, histogram.last());
+}
+
+std::string CBorderStats::toJson(const SMemoryStats &memory) const {
+  std::string stages;
+  for (size_t i = 0; i < STAT_COUNT; i++)
+    stages += std::format(R"({}"{}": {})", i ? ", " : "", STAGE_NAMES[i],
+                          histogramJson(m_stages[i], "Ns"));
+
+  return std::format(
+      R"({{"enabled": {}, "gpuTimers": {}, "stages": {{{}}}, )"
+      R"("drawCallsPerFrame": {}, )"
+      R"("textures": {{"themes": {}, "composed": {}, "alive": {}}}, )"
+      R"("vramBytes": {{"themes": {}, "composed": {}, "total": {}}}}})",
+      enabled(), m_gpuTimers == GPU_TIMERS_OK, stages,
+      histogramJson(m_frameDraws, ""), memory.themeTextures,
+      memory.composedTextures, memory.themeTextures + memory.composedTextures,
+      memory.themeBytes, memory.composedBytes,
+      memory.themeBytes + memory.composedBytes);
+}
+
+std::string CBorderStats::toText(const SMemoryStats &memory) const {
+  std::string text = std::format(
+      "stats: {}, GPU timers: {}\n", enabled() ? "on" : "off",
+      m_gpuTimers == GPU_TIMERS_OK        ? "yes"
+      : m_gpuTimers == GPU_TIMERS_MISSING ? "unsupported"
+                                          : "not used yet");
+
+  const auto US = [](uint64_t ns) { return (double)ns / 1000.0; };
+  for (size_t i = 0; i < STAT_COUNT; i++) {
+    const auto &STAGE = m_stages[i];
+    const auto COUNT = STAGE.count();
+    text += std::format(
+        "{}: {} times, mean {:.1f} us, p50 {:.1f} us, p99 {:.1f} us, max "
+        "{:.1f} us\n",
+        STAGE_NAMES[i], COUNT, COUNT ? US(STAGE.sum() / COUNT) : 0.0,
+        US(STAGE.percentile(0.5)), US(STAGE.percentile(0.99)),
+        US(STAGE.max()));
+  }
+
+  const auto FRAMES = m_frameDraws.count();
+  text += std::format(
+      "draw calls per frame: {} frames, mean {}, p99 {}, max {}\n", FRAMES,
+      FRAMES ? m_frameDraws.sum() / FRAMES : 0, m_frameDraws.percentile(0.99),
+      m_frameDraws.max());
+  text += std::format("textures: {} themes ({} KiB), {} composed ({} KiB)\n",
+                      memory.themeTextures, memory.themeBytes >> 10,
+                      memory.composedTextures, memory.composedBytes >> 10);
+  return text;
+}
+
+CStatTimer::CStatTimer(CBorderStats &stats, eStatStage stage)
+    : m_stats(stats), m_stage(stage), m_active(stats.enabled()) {
+  if (m_active)
+    m_start = std::chrono::steady_clock::now();
+}
+
+CStatTimer::~CStatTimer() {
+  if (!m_active)
+    return;
+  const auto ELAPSED = std::chrono::steady_clock::now() - m_start;
+  m_stats.record(
+      m_stage,
+      std::chrono::duration_cast<std::chrono::nanoseconds>(ELAPSED).count());
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <GLES3/gl32.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+// What gets timed, each into its own histogram
+enum eStatStage : uint8_t {
+  // Drawing one batch of borders, on the CPU
+  STAT_DRAW = 0,
+  // The same draws on the GPU, from timer queries
+  STAT_DRAW_GPU,
+  // Laying out one border
+  STAT_LAYOUT,
+  // Reading and decoding an image, or taking it from the disk cache
+  STAT_LOAD,
+  // Cutting, measuring, padding or resampling a decoded image
+  STAT_SLICE,
+  // Uploading a decoded image
+  STAT_UPLOAD,
+  // Handling a config reload
+  STAT_RELOAD,
+  STAT_COUNT,
+};
+
+// Values in power of two buckets, so percentiles are only good to a factor
+// of 2 but recording never allocates or locks. Safe from any thread.
+class CStatHistogram {
+public:
+  // Bucket i holds values below 2^i, the last everything bigger
+  static constexpr size_t BUCKETS = 48;
+
+  void record(uint64_t value);
+  void reset();
+
+  uint64_t count() const;
+  uint64_t sum() const;
+  uint64_t max() const;
+  uint64_t last() const;
+  // Upper bound of the bucket holding fraction p of the values
+  uint64_t percentile(double p) const;
+
+private:
+  std::array<std::atomic<uint64_t>, BUCKETS> m_buckets = {};
+  std::atomic<uint64_t> m_count = 0;
+  std::atomic<uint64_t> m_sum = 0;
+  std::atomic<uint64_t> m_max = 0;
+  std::atomic<uint64_t> m_last = 0;
+};
+
+// Video memory held by the plugin, counted when stats are asked for
+struct SMemoryStats {
+  size_t themeTextures = 0;
+  size_t themeBytes = 0;
+  size_t composedTextures = 0;
+  size_t composedBytes = 0;
+};
+
+// Timings and counters behind plugin:imgborders:stats. While it's off,
+// recording is one relaxed load and nothing is timed on the GPU.
+class CBorderStats {
+public:
+  bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+  void setEnabled(bool enabled);
+
+  // Safe from any thread
+  void record(eStatStage stage, uint64_t ns);
+  void countDraws(uint64_t draws);
+
+  // Everything below is for the render thread. Called as a monitor starts
+  // rendering, closes the last frame and collects finished GPU timers.
+  void beginFrame();
+
+  // Time the GPU spends on what's drawn between the two. Needs the render
+  // context current, does nothing without GL_EXT_disjoint_timer_query.
+  void beginGpuTimer();
+  void endGpuTimer();
+
+  void reset();
+
+  // With the render context current
+  void destroy();
+
+  std::string toJson(const SMemoryStats &memory) const;
+  std::string toText(const SMemoryStats &memory) const;
+
+private:
+  // Whether timer queries work, checked once with a context current
+  bool gpuTimersSupported();
+  void collectGpuTimers();
+
+  std::atomic<bool> m_enabled = false;
+  std::array<CStatHistogram, STAT_COUNT> m_stages;
+  // Draw calls of every frame that drew a border
+  CStatHistogram m_frameDraws;
+  std::atomic<uint64_t> m_draws = 0;
+
+  enum eGpuTimers : uint8_t {
+    GPU_TIMERS_UNKNOWN,
+    GPU_TIMERS_MISSING,
+    GPU_TIMERS_OK,
+  } m_gpuTimers = GPU_TIMERS_UNKNOWN;
+  // Queries not in flight, and those in flight oldest first
+  std::vector<GLuint> m_freeQueries;
+  std::deque<GLuint> m_pendingQueries;
+  GLuint m_activeQuery = 0;
+  size_t m_queries = 0;
+};
+
+// Records the time until it goes out of scope into stage, if stats are on
+class CStatTimer {
+public:
+  CStatTimer(CBorderStats &stats, eStatStage stage);
+  ~CStatTimer();
+
+  CStatTimer(const CStatTimer &) = delete;
+  CStatTimer &operator=(const CStatTimer &) = delete;
+
+private:
+  CBorderStats &m_stats;
+  eStatStage m_stage;
+  bool m_active;
+  std::chrono::steady_clock::time_point m_start;
+};
@@ -0,0 +1,260 @@
+#include "ConfigSnapshot.hpp"
+#include "ThemeCache.hpp"
+#include "globals.hpp"
+#include <algorithm>
+#include <format>
+#include <hyprland/src/plugins/PluginAPI.hpp>
+#include <sstream>
+#include <wordexp.h>
+
+template <size_t N>
+static bool parseInts(const char *str, std::array<int, N> &outArr) {
+  auto strStream = std::stringstream(str);
+  for (size_t i = 0; i < N; i++) {
+    try {
+      std::string intStr;
+      std::getline(strStream, intStr, ',');
+      outArr[i] = std::stoi(intStr);
+    } catch (...) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static Hyprlang::INT readInt(const char *name) {
+  return **(Hyprlang::INT *const *)HyprlandAPI::getConfigValue(PHANDLE, name)
+              ->getDataStaticPtr();
+}
+
+// Options a theme may set, everything else is shared by all themes
+static constexpr std::array THEME_OPTIONS = {
+    "image",         "sizes",            "horsizes",
+    "versizes",      "topplacements",    "bottomplacements",
+    "leftplacements", "rightplacements", "insets",
+    "scale",         "frames",           "fps",
+    "states",
+};
+
+// The value of plugin:imgborders:<option>, or what decl sets it to
+static std::string readString(const SThemeDecl *decl, const char *option) {
+  if (decl) {
+    if (const auto IT = decl->options.find(option); IT != decl->options.end())
+      return IT->second;
+  }
+
+  const auto STR = (Hyprlang::STRING const *)HyprlandAPI::getConfigValue(
+                       PHANDLE, std::format("plugin:imgborders:{}", option))
+                       ->getDataStaticPtr();
+  return STR && *STR ? *STR : "";
+}
+
+// Fills out from the comma separated ints in option, or sets error
+template <size_t N>
+static bool readInts(const SThemeDecl *decl, const char *option,
+                     std::array<int, N> &out, std::string &error) {
+  const auto STR = readString(decl, option);
+  if (STR.empty()) {
+    error = std::format("missing {} in config", option);
+    return false;
+  }
+  if (!parseInts(STR.c_str(), out)) {
+    error = std::format("invalid {} in config", option);
+    return false;
+  }
+  return true;
+}
+
+// plugin:imgborders:<option>, or what decl sets it to. Sets error unless
+// an earlier problem already did.
+static float readFloat(const SThemeDecl *decl, const char *option,
+                       std::string &error) {
+  float value = **(Hyprlang::FLOAT *const *)HyprlandAPI::getConfigValue(
+                    PHANDLE, std::format("plugin:imgborders:{}", option))
+                    ->getDataStaticPtr();
+  if (decl && decl->options.contains(option)) {
+    try {
+      value = std::stof(decl->options.at(option));
+    } catch (...) {
+      if (error.empty())
+        error = std::format("invalid {} in config", option);
+    }
+  }
+  return value;
+}
+
+// plugin:imgborders:<option>, or what decl sets it to. Sets error unless
+// an earlier problem already did.
+static int readThemeInt(const SThemeDecl *decl, const char *option,
+                        std::string &error) {
+  int value = readInt(std::format("plugin:imgborders:{}", option).c_str());
+  if (decl && decl->options.contains(option)) {
+    try {
+      value = std::stoi(decl->options.at(option));
+    } catch (...) {
+      if (error.empty())
+        error = std::format("invalid {} in config", option);
+    }
+  }
+  return value;
+}
+
+// One snapshot, the global config if decl is null
+static SP<SConfigSnapshot> readOne(uint64_t generation, const std::string &name,
+                                   const SThemeDecl *decl) {
+  auto config = makeShared<SConfigSnapshot>();
+  config->generation = generation;
+  config->name = name;
+
+  // hidden
+  config->enabled = readInt("plugin:imgborders:enabled");
+  if (!config->enabled)
+    return config;
+
+  // image
+  const auto texSrc = readString(decl, "image");
+  wordexp_t p;
+  std::string texSrcExpanded;
+  const int EXPANDED = wordexp(texSrc.c_str(), &p, 0);
+  if (EXPANDED == 0) {
+    for (size_t i = 0; i < p.we_wordc; i++)
+      texSrcExpanded.append(p.we_wordv[i]);
+    wordfree(&p);
+  } else {
+    // Out of memory is the only failure that leaves words behind
+    if (EXPANDED == WRDE_NOSPACE)
+      wordfree(&p);
+    if (config->error.empty())
+      config->error = std::format("can't expand image path {}", texSrc);
+  }
+
+  auto &key = config->themeKey;
+  const bool OK =
+      readInts(decl, "sizes", key.sizes, config->error) &&
+      // 7x7 horsizes and versizes
+      readInts(decl, "horsizes", key.horSizes, config->error) &&
+      readInts(decl, "versizes", key.verSizes, config->error) &&
+      // Independent edge placements
+      readInts(decl, "topplacements", config->topPlacements, config->error) &&
+      readInts(decl, "bottomplacements", config->bottomPlacements,
+               config->error) &&
+      readInts(decl, "leftplacements", config->leftPlacements,
+               config->error) &&
+      readInts(decl, "rightplacements", config->rightPlacements,
+               config->error) &&
+      readInts(decl, "insets", config->insets, config->error);
+
+  if (OK && config->error.empty() &&
+      !CThemeCache::makeKey(texSrcExpanded, key))
+    config->error = std::format("{} image at doesn't exist", texSrcExpanded);
+
+  config->scale = readFloat(decl, "scale", config->error);
+  config->fps = readFloat(decl, "fps", config->error);
+  key.frames = readThemeInt(decl, "frames", config->error);
+  if (key.frames < 1 && config->error.empty())
+    config->error = "frames has to be at least 1";
+  key.states = readThemeInt(decl, "states", config->error);
+  if (key.states != 1 && key.states != 2 && config->error.empty())
+    config->error = "states has to be 1 or 2";
+
+  if (!config->error.empty()) {
+    config->error = name.empty()
+                        ? std::format("[imgborders] {}", config->error)
+                        : std::format("[imgborders] theme {}: {}", name,
+                                      config->error);
+    HyprlandAPI::addNotification(PHANDLE, config->error,
+                                 CHyprColor{1.0, 0.1, 0.1, 1.0}, 5000);
+    config->enabled = false;
+    return config;
+  }
+
+  config->sizes = key.sizes;
+
+  config->smooth = readInt("plugin:imgborders:smooth");
+  config->blurGlobal = readInt("decoration:blur:enabled");
+  config->blur = readInt("plugin:imgborders:blur");
+
+  // Only smoothed borders sample between texels, so only they get mips
+  key.mipmap = config->smooth && readInt("plugin:imgborders:mipmap");
+  key.compact16 = readInt("plugin:imgborders:compact");
+
+  return config;
+}
+
+SP<const SConfigSnapshot>
+ConfigUtils::read(uint64_t generation,
+                  const std::unordered_map<std::string, SThemeDecl> &themes) {
+  auto config = readOne(generation, "", nullptr);
+  for (const auto &[NAME, DECL] : themes)
+    config->themes[NAME] = readOne(generation, NAME, &DECL);
+  return config;
+}
+
+static std::string_view trim(std::string_view str) {
+  const auto BEGIN = str.find_first_not_of(" \t");
+  if (BEGIN == std::string_view::npos)
+    return {};
+  return str.substr(BEGIN, str.find_last_not_of(" \t") - BEGIN + 1);
+}
+
+bool ConfigUtils::declareTheme(
+    std::string_view line, std::unordered_map<std::string, SThemeDecl> &themes,
+    std::string &error) {
+  const auto FIRST = line.find(',');
+  const auto SECOND =
+      FIRST == std::string_view::npos ? FIRST : line.find(',', FIRST + 1);
+  if (SECOND == std::string_view::npos) {
+    error = "expected name, option, value";
+    return false;
+  }
+
+  const auto NAME = trim(line.substr(0, FIRST));
+  const auto OPTION = trim(line.substr(FIRST + 1, SECOND - FIRST - 1));
+  const auto VALUE = trim(line.substr(SECOND + 1));
+  if (NAME.empty()) {
+    error = "theme has no name";
+    return false;
+  }
+  if (std::ranges::find(THEME_OPTIONS, OPTION) == THEME_OPTIONS.end()) {
+    error = std::format("themes can't set {}", OPTION);
+    return false;
+  }
+
+  themes[std::string(NAME)].options[std::string(OPTION)] = VALUE;
+  return true;
+}
+
+const SP<const SConfigSnapshot> &
+ConfigUtils::resolve(const SP<const SConfigSnapshot> &config,
+                     const std::string &name) {
+  if (name.empty())
+    return config;
+  const auto IT = config->themes.find(name);
+  return IT == config->themes.end() ? config : IT->second;
+}
+
+uint8_t ConfigUtils::diff(const SConfigSnapshot *prev,
+                          const SConfigSnapshot &next) {
+  if (!prev || !prev->enabled || !next.enabled)
+    return CONFIG_ALL;
+
+  uint8_t changes = CONFIG_UNCHANGED;
+
+  // Same path and mtime, the theme cache has the image already
+  if (prev->themeKey != next.themeKey)
+    changes |= CONFIG_THEME;
+
+  if (prev->sizes != next.sizes || prev->insets != next.insets ||
+      prev->topPlacements != next.topPlacements ||
+      prev->bottomPlacements != next.bottomPlacements ||
+      prev->leftPlacements != next.leftPlacements ||
+      prev->rightPlacements != next.rightPlacements ||
+      prev->scale != next.scale)
+    changes |= CONFIG_LAYOUT;
+
+  if (prev->smooth != next.smooth || prev->blurGlobal != next.blurGlobal ||
+      prev->blur != next.blur || prev->fps != next.fps)
+    changes |= CONFIG_STYLE;
+
+  return changes;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Theme.hpp"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Options set by imgborders-theme lines for one named theme, by option name
+// (image, sizes, ...) without the plugin:imgborders: prefix. Anything not
+// set comes from the global option.
+struct SThemeDecl {
+  std::unordered_map<std::string, std::string> options;
+};
+
+// plugin:imgborders:* parsed once per reload. Never changed after it's made,
+// every border holds the one it was configured from.
+struct SConfigSnapshot {
+  // Goes up with every reload
+  uint64_t generation = 0;
+
+  // Of the named theme, empty for the global config
+  std::string name;
+
+  bool enabled = false;
+  // Why the border is off despite being enabled, empty if it isn't
+  std::string error;
+
+  // Image, slices and how they're uploaded. sizes, horSizes and verSizes
+  // below are the same as in here.
+  SThemeKey themeKey;
+
+  std::array<int, 4> sizes = {};
+  std::array<int, 4> insets = {};
+  std::array<int, 2> topPlacements = {};
+  std::array<int, 2> bottomPlacements = {};
+  std::array<int, 2> leftPlacements = {};
+  std::array<int, 2> rightPlacements = {};
+
+  float scale = 1.F;
+  // Of animated themes, the frame count is in themeKey
+  float fps = 0.F;
+  bool smooth = false;
+  // decoration:blur:enabled and plugin:imgborders:blur
+  bool blurGlobal = false;
+  bool blur = false;
+
+  // Named themes, only set on the global config
+  std::unordered_map<std::string, SP<const SConfigSnapshot>> themes;
+};
+
+// What differs between two snapshots, by what it takes to follow the change
+enum eConfigChange : uint8_t {
+  CONFIG_UNCHANGED = 0,
+  // Geometry only, the theme stays
+  CONFIG_LAYOUT = 1 << 0,
+  // Drawn differently from the same theme
+  CONFIG_STYLE = 1 << 1,
+  // Needs another theme
+  CONFIG_THEME = 1 << 2,
+  CONFIG_ALL = CONFIG_LAYOUT | CONFIG_STYLE | CONFIG_THEME,
+};
+
+namespace ConfigUtils {
+// Reads and parses the current config, and every theme in themes on top of
+// it. Errors leave that snapshot disabled with error set.
+SP<const SConfigSnapshot>
+read(uint64_t generation,
+     const std::unordered_map<std::string, SThemeDecl> &themes);
+
+// Adds an imgborders-theme line (name, option, value) to themes. Values may
+// have commas in them.
+bool declareTheme(std::string_view line,
+                  std::unordered_map<std::string, SThemeDecl> &themes,
+                  std::string &error);
+
+// The theme called name in config, or config itself if name is empty or
+// there's no theme by that name
+const SP<const SConfigSnapshot> &
+resolve(const SP<const SConfigSnapshot> &config, const std::string &name);
+
+// eConfigChange flags for going from prev to next. Everything if there's no
+// prev or either is off.
+uint8_t diff(const SConfigSnapshot *prev, const SConfigSnapshot &next);
+} // namespace ConfigUtils
@@ -0,0 +1,278 @@
+#include "DiskCache.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// Bumped whenever the layout below or what goes into it changes
+constexpr uint32_t CACHE_VERSION = 3;
+constexpr char CACHE_MAGIC[4] = {'I', 'M', 'G', 'B'};
+
+// Past this, least recently used entries are deleted after each store
+constexpr uintmax_t CACHE_MAX_BYTES = 256ull << 20;
+
+// Written as is, the cache never leaves the machine that wrote it
+struct SCacheHeader {
+  char magic[4] = {};
+  uint32_t version = 0;
+  uint64_t sourceHash = 0;
+
+  // How the image was cut and processed
+  int32_t sizes[4] = {};
+  int32_t horSizes[4] = {};
+  int32_t verSizes[4] = {};
+  uint8_t mipmap = 0;
+  uint8_t compact16 = 0;
+  int32_t frames = 1;
+  int32_t states = 1;
+
+  // The SImageData, pixels follow the header
+  uint8_t swapRB = 0;
+  uint8_t noAlpha = 0;
+  uint8_t hasSwizzle = 0;
+  int32_t swizzle[4] = {};
+  int32_t internalFormat = 0;
+  uint32_t format = 0;
+  uint32_t type = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  int32_t mipLevels = 0;
+  uint64_t pixelBytes = 0;
+
+  float gutter = 0;
+  float sections[SECTION_COUNT][4] = {};
+  SSectionCoverage coverage[SECTION_COUNT] = {};
+};
+
+static void fillParams(const SThemeKey &key, SCacheHeader &header) {
+  std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  header.version = CACHE_VERSION;
+  for (size_t i = 0; i < 4; i++) {
+    header.sizes[i] = key.sizes[i];
+    header.horSizes[i] = key.horSizes[i];
+    header.verSizes[i] = key.verSizes[i];
+  }
+  header.mipmap = key.mipmap;
+  header.compact16 = key.compact16;
+  header.frames = key.frames;
+  header.states = key.states;
+}
+
+static std::filesystem::path cacheDir() {
+  if (const auto XDG = getenv("XDG_CACHE_HOME"); XDG && *XDG)
+    return std::filesystem::path(XDG) / "imgborders";
+  if (const auto HOME = getenv("HOME"); HOME && *HOME)
+    return std::filesystem::path(HOME) / ".cache" / "imgborders";
+  return {};
+}
+
+// One entry per image and set of parameters. A rewritten image replaces its
+// entry, which is checked against the source hash on load.
+static std::filesystem::path entryPath(const SThemeKey &key) {
+  const auto DIR = cacheDir();
+  if (DIR.empty())
+    return {};
+
+  std::vector<int32_t> params = {(int32_t)CACHE_VERSION, key.mipmap,
+                                 key.compact16, key.frames, key.states};
+  params.insert(params.end(), key.sizes.begin(), key.sizes.end());
+  params.insert(params.end(), key.horSizes.begin(), key.horSizes.end());
+  params.insert(params.end(), key.verSizes.begin(), key.verSizes.end());
+
+  const auto PATHHASH = ImgUtils::contentHash(
+      {(const uint8_t *)key.path.data(), key.path.size()});
+  const auto PARAMSHASH = ImgUtils::contentHash(
+      {(const uint8_t *)params.data(), params.size() * sizeof(int32_t)});
+
+  return DIR / std::format("{:016x}-{:016x}.theme", PATHHASH, PARAMSHASH);
+}
+
+bool DiskCache::load(const SDecodeJob &job, SDecodeResult &result) {
+  const auto PATH = entryPath(job.key);
+  if (PATH.empty())
+    return false;
+
+  const int FD = open(PATH.c_str(), O_RDONLY | O_CLOEXEC);
+  if (FD < 0)
+    return false;
+
+  struct stat st = {};
+  if (fstat(FD, &st) != 0 || (size_t)st.st_size < sizeof(SCacheHeader)) {
+    close(FD);
+    return false;
+  }
+
+  const size_t SIZE = st.st_size;
+  void *addr = mmap(nullptr, SIZE, PROT_READ, MAP_PRIVATE, FD, 0);
+  close(FD);
+  if (addr == MAP_FAILED)
+    return false;
+
+  // Unmapped with the last image referencing it, after the upload
+  std::shared_ptr<const void> mapping(
+      addr, [SIZE](const void *p) { munmap(const_cast<void *>(p), SIZE); });
+
+  SCacheHeader header;
+  std::memcpy(&header, addr, sizeof(header));
+
+  SCacheHeader expected;
+  fillParams(job.key, expected);
+  const bool MATCHES =
+      std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 &&
+      header.version == CACHE_VERSION && header.sourceHash == result.hash &&
+      std::ranges::equal(header.sizes, expected.sizes) &&
+      std::ranges::equal(header.horSizes, expected.horSizes) &&
+      std::ranges::equal(header.verSizes, expected.verSizes) &&
+      header.mipmap == expected.mipmap &&
+      header.compact16 == expected.compact16 &&
+      header.frames == expected.frames && header.states == expected.states;
+  if (!MATCHES)
+    return false;
+
+  auto &image = result.image;
+  image.size = {(double)header.width, (double)header.height};
+  image.internalFormat = header.internalFormat;
+  image.format = header.format;
+  image.type = header.type;
+  image.swapRB = header.swapRB;
+  image.noAlpha = header.noAlpha;
+  image.mipLevels = header.mipLevels;
+  if (header.hasSwizzle)
+    image.swizzle = {header.swizzle[0], header.swizzle[1], header.swizzle[2],
+                     header.swizzle[3]};
+
+  // Truncated, or not what the header says
+  const size_t PIXELBYTES = (size_t)header.width * header.height *
+                            ImgUtils::texelBytes(image);
+  if (header.pixelBytes != PIXELBYTES ||
+      SIZE - sizeof(SCacheHeader) < PIXELBYTES) {
+    image = {};
+    return false;
+  }
+
+  image.mapping = std::move(mapping);
+  image.mappedPixels = (const uint8_t *)addr + sizeof(SCacheHeader);
+
+  // Used, so it's the last to be pruned
+  std::error_code ec;
+  std::filesystem::last_write_time(
+      PATH, std::filesystem::file_time_type::clock::now(), ec);
+
+  for (size_t i = 0; i < SECTION_COUNT; i++) {
+    const auto *S = header.sections[i];
+    result.sections[i] = {S[0], S[1], S[2], S[3]};
+    result.coverage[i] = header.coverage[i];
+  }
+  result.gutter = header.gutter;
+
+  return true;
+}
+
+// Deletes entries, oldest written or loaded first, until the rest fit in
+// CACHE_MAX_BYTES. Entries of images that changed their cut, moved or are
+// gone would otherwise pile up forever.
+static void prune(const std::filesystem::path &dir,
+                  const std::filesystem::path &keep) {
+  struct SEntry {
+    std::filesystem::path path;
+    std::filesystem::file_time_type mtime;
+    uintmax_t bytes = 0;
+  };
+
+  std::error_code ec;
+  std::vector<SEntry> entries;
+  uintmax_t total = 0;
+  // Not range-for, which would throw from the worker on a read error
+  for (auto it = std::filesystem::directory_iterator(dir, ec);
+       !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+    if (it->path().extension() != ".theme" || it->path() == keep)
+      continue;
+    std::error_code fileEc;
+    const auto BYTES = it->file_size(fileEc);
+    const auto MTIME = it->last_write_time(fileEc);
+    if (fileEc)
+      continue;
+    entries.push_back({it->path(), MTIME, BYTES});
+    total += BYTES;
+  }
+
+  // The entry just written stays whatever its size
+  total += std::filesystem::file_size(keep, ec);
+  if (ec || total <= CACHE_MAX_BYTES)
+    return;
+
+  std::ranges::sort(entries, {}, &SEntry::mtime);
+  for (const auto &ENTRY : entries) {
+    if (total <= CACHE_MAX_BYTES)
+      break;
+    if (std::filesystem::remove(ENTRY.path, ec))
+      total -= ENTRY.bytes;
+  }
+}
+
+void DiskCache::store(const SDecodeJob &job, const SDecodeResult &result) {
+  const auto PATH = entryPath(job.key);
+  if (PATH.empty())
+    return;
+
+  std::error_code ec;
+  std::filesystem::create_directories(PATH.parent_path(), ec);
+  if (ec)
+    return;
+
+  const auto &IMAGE = result.image;
+  SCacheHeader header;
+  fillParams(job.key, header);
+  header.sourceHash = result.hash;
+  header.swapRB = IMAGE.swapRB;
+  header.noAlpha = IMAGE.noAlpha;
+  header.hasSwizzle = IMAGE.swizzle.has_value();
+  if (IMAGE.swizzle)
+    std::ranges::copy(*IMAGE.swizzle, header.swizzle);
+  header.internalFormat = IMAGE.internalFormat;
+  header.format = IMAGE.format;
+  header.type = IMAGE.type;
+  header.width = IMAGE.size.x;
+  header.height = IMAGE.size.y;
+  header.mipLevels = IMAGE.mipLevels;
+  header.pixelBytes = (uint64_t)header.width * header.height *
+                      ImgUtils::texelBytes(IMAGE);
+  header.gutter = result.gutter;
+  for (size_t i = 0; i < SECTION_COUNT; i++) {
+    const auto &SEC = result.sections[i];
+    header.sections[i][0] = SEC.x;
+    header.sections[i][1] = SEC.y;
+    header.sections[i][2] = SEC.width;
+    header.sections[i][3] = SEC.height;
+    header.coverage[i] = result.coverage[i];
+  }
+
+  // Written aside and renamed over, so a reader never sees half a file
+  auto tmp = PATH;
+  tmp += std::format(".{}.tmp", getpid());
+  {
+    std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+    file.write((const char *)&header, sizeof(header));
+    file.write((const char *)IMAGE.data(), header.pixelBytes);
+    if (!file.good()) {
+      file.close();
+      std::filesystem::remove(tmp, ec);
+      return;
+    }
+  }
+
+  std::filesystem::rename(tmp, PATH, ec);
+  if (ec) {
+    std::filesystem::remove(tmp, ec);
+    return;
+  }
+
+  prune(PATH.parent_path(), PATH);
+}
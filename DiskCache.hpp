@@ -0,0 +1,18 @@
+#pragma once
+
+#include "ThemeLoader.hpp"
+
+// Decoded themes kept on disk under $XDG_CACHE_HOME/imgborders, GL-ready and
+// with their sections and coverage, keyed by the image's contents and how
+// it's cut. Loading one maps the file and uploads from the mapping, so no PNG
+// is inflated for images seen before. Everything here runs on the worker.
+namespace DiskCache {
+// Fills image, sections, coverage and gutter of result from the cache.
+// False if there's no usable entry for the job and result.hash.
+bool load(const SDecodeJob &job, SDecodeResult &result);
+
+// Writes a freshly decoded result, then trims the cache to its size limit,
+// least recently used entries first. Failures are ignored, the next load
+// just decodes again.
+void store(const SDecodeJob &job, const SDecodeResult &result);
+} // namespace DiskCache
@@ -0,0 +1,139 @@
+#include "FileWatcher.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <hyprland/src/Compositor.hpp>
+#include <hyprland/src/debug/Log.hpp>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <wayland-server-core.h>
+
+CFileWatcher::CFileWatcher(FOnChanged onChanged)
+    : m_onChanged(std::move(onChanged)) {}
+
+CFileWatcher::~CFileWatcher() { stop(); }
+
+bool CFileWatcher::start() {
+  if (m_inotifyFd >= 0)
+    return true;
+
+  if (!g_pCompositor || !g_pCompositor->m_wlEventLoop)
+    return false;
+
+  m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (m_inotifyFd < 0) {
+    Debug::log(ERR, "[imgborders] inotify_init1 failed: {}", strerror(errno));
+    return false;
+  }
+
+  m_eventSource =
+      wl_event_loop_add_fd(g_pCompositor->m_wlEventLoop, m_inotifyFd,
+                           WL_EVENT_READABLE, onInotify, this);
+  if (!m_eventSource) {
+    close(m_inotifyFd);
+    m_inotifyFd = -1;
+    return false;
+  }
+
+  return true;
+}
+
+void CFileWatcher::stop() {
+  if (m_eventSource) {
+    wl_event_source_remove(m_eventSource);
+    m_eventSource = nullptr;
+  }
+  if (m_inotifyFd >= 0) {
+    close(m_inotifyFd);
+    m_inotifyFd = -1;
+  }
+
+  m_dirs.clear();
+}
+
+void CFileWatcher::watch(const std::string &path) {
+  if (!start())
+    return;
+
+  const std::filesystem::path FSPATH(path);
+  const auto DIR = FSPATH.parent_path().string();
+  const auto NAME = FSPATH.filename().string();
+
+  auto &dir = m_dirs[DIR];
+  if (dir.wd < 0) {
+    // Written in place, or written elsewhere and renamed over
+    dir.wd = inotify_add_watch(m_inotifyFd, DIR.c_str(),
+                               IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (dir.wd < 0) {
+      Debug::log(ERR, "[imgborders] can't watch {}: {}", DIR, strerror(errno));
+      m_dirs.erase(DIR);
+      return;
+    }
+  }
+
+  if (std::ranges::find(dir.names, NAME) == dir.names.end())
+    dir.names.push_back(NAME);
+}
+
+void CFileWatcher::unwatch(const std::string &path) {
+  const std::filesystem::path FSPATH(path);
+  const auto IT = m_dirs.find(FSPATH.parent_path().string());
+  if (IT == m_dirs.end())
+    return;
+
+  std::erase(IT->second.names, FSPATH.filename().string());
+  if (!IT->second.names.empty())
+    return;
+
+  inotify_rm_watch(m_inotifyFd, IT->second.wd);
+  m_dirs.erase(IT);
+}
+
+void CFileWatcher::readEvents() {
+  alignas(inotify_event) char buf[4096];
+  std::vector<std::string> changed;
+
+  while (true) {
+    const auto LEN = read(m_inotifyFd, buf, sizeof(buf));
+    if (LEN <= 0)
+      break;
+
+    for (ssize_t off = 0; off < LEN;) {
+      const auto *EVENT = (const inotify_event *)(buf + off);
+      off += sizeof(inotify_event) + EVENT->len;
+
+      const auto DIR =
+          std::ranges::find_if(m_dirs, [EVENT](const auto &d) {
+            return d.second.wd == EVENT->wd;
+          });
+      if (DIR == m_dirs.end())
+        continue;
+
+      // The directory itself went away
+      if (EVENT->mask & IN_IGNORED) {
+        m_dirs.erase(DIR);
+        continue;
+      }
+
+      if (!EVENT->len)
+        continue;
+
+      const std::string NAME = EVENT->name;
+      if (std::ranges::find(DIR->second.names, NAME) == DIR->second.names.end())
+        continue;
+
+      const auto PATH = (std::filesystem::path(DIR->first) / NAME).string();
+      if (std::ranges::find(changed, PATH) == changed.end())
+        changed.push_back(PATH);
+    }
+  }
+
+  for (const auto &path : changed)
+    m_onChanged(path);
+}
+
+int CFileWatcher::onInotify(int fd, uint32_t mask, void *data) {
+  static_cast<CFileWatcher *>(data)->readEvents();
+  return 0;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct wl_event_source;
+
+// Tells when watched files get rewritten, through inotify on the compositor's
+// event loop. Parent directories are watched rather than the files, so writers
+// that rename a temporary file over the old one are caught too.
+class CFileWatcher {
+public:
+  using FOnChanged = std::function<void(const std::string &path)>;
+
+  explicit CFileWatcher(FOnChanged onChanged);
+  ~CFileWatcher();
+
+  void watch(const std::string &path);
+  void unwatch(const std::string &path);
+
+  void stop();
+
+private:
+  bool start();
+  void readEvents();
+
+  static int onInotify(int fd, uint32_t mask, void *data);
+
+  FOnChanged m_onChanged;
+
+  int m_inotifyFd = -1;
+  wl_event_source *m_eventSource = nullptr;
+
+  struct SWatchedDir {
+    int wd = -1;
+    std::vector<std::string> names;
+  };
+  std::unordered_map<std::string, SWatchedDir> m_dirs;
+};
@@ -1,29 +1,31 @@
 #include "ImgBorder.hpp"
+#include "BorderBatch.hpp"
+#include "BorderLayout.hpp"
 #include "ImgBorderPassElement.hpp"
 #include "ImgUtils.hpp"
 #include "globals.hpp"
 #include <algorithm>
 #include <cmath>
-#include <filesystem>
 #include <vector>
 #include <hyprland/src/Compositor.hpp>
 #include <hyprland/src/SharedDefs.hpp>
 #include <hyprland/src/debug/Log.hpp>
 #include <hyprland/src/desktop/DesktopTypes.hpp>
+#include <hyprland/src/desktop/Workspace.hpp>
 #include <hyprland/src/plugins/PluginAPI.hpp>
 #include <hyprland/src/render/OpenGL.hpp>
 #include <hyprland/src/render/Renderer.hpp>
 #include <hyprland/src/render/Texture.hpp>
 #include <hyprland/src/render/decorations/DecorationPositioner.hpp>
 #include <hyprutils/math/Vector2D.hpp>
-#include <wordexp.h>
 
 CImgBorder::CImgBorder(PHLWINDOW pWindow) : IHyprWindowDecoration(pWindow) {
   m_pWindow = pWindow;
-  updateConfig();
+  readRules();
+  applyConfig(g_pGlobalState->config);
 }
 
-CImgBorder::~CImgBorder() { std::erase(g_pGlobalState->borders, m_self); }
+CImgBorder::~CImgBorder() { g_pGlobalState->borders.unregister(this); }
 
 SDecorationPositioningInfo CImgBorder::getPositioningInfo() {
   SDecorationPositioningInfo info;
@@ -32,11 +34,14 @@ SDecorationPositioningInfo CImgBorder::getPositioningInfo() {
                DECORATION_EDGE_TOP | DECORATION_EDGE_BOTTOM;
   info.priority = 9990;
   if (m_isEnabled && !m_isHidden) {
+    const auto &SIZES = m_config->sizes;
+    const auto &INSETS = m_config->insets;
+    const float SCALE = m_config->scale;
     info.desiredExtents = {
-        .topLeft = {(m_sizes[0] - m_insets[0]) * m_scale,
-                    (m_sizes[2] - m_insets[2]) * m_scale},
-        .bottomRight = {(m_sizes[1] - m_insets[1]) * m_scale,
-                        (m_sizes[3] - m_insets[3]) * m_scale},
+        .topLeft = {(SIZES[0] - INSETS[0]) * SCALE,
+                    (SIZES[2] - INSETS[2]) * SCALE},
+        .bottomRight = {(SIZES[1] - INSETS[1]) * SCALE,
+                        (SIZES[3] - INSETS[3]) * SCALE},
     };
   }
   info.reserved = true;
@@ -54,361 +59,265 @@ void CImgBorder::draw(PHLMONITOR pMonitor, const float &a) {
   if (!PWINDOW->m_windowData.decorate.valueOrDefault())
     return;
 
+  if (!m_isEnabled || m_isHidden)
+    return;
+
+  // Borders only hold a theme once they're on screen
+  m_lastDrawn = std::chrono::steady_clock::now();
+  if (!m_theme && !m_nextTheme)
+    acquireTheme();
+
+  if (!m_theme || !m_theme->atlas)
+    return;
+
+  if (m_theme->frames > 1)
+    g_pGlobalState->animator.start();
+
+  SBorderInstance instance;
+  bool settled = false;
+  if (!makeInstance(pMonitor, 1.F, instance, &settled))
+    return;
+
+  const bool BLUR = shouldBlur();
+  if (BLUR) {
+    // Only the translucent parts of the border, everything else is either
+    // covered or never drawn
+    m_layout.blur.copy()
+        .translate(instance.box.pos())
+        .forEachRect([this](const auto &RECT) {
+          g_pHyprRenderer->m_renderPass.add(
+              makeUnique<CImgBorderPassElement>(CImgBorderPassElement::SData{
+                  .deco = this,
+                  .blurBox = {(double)RECT.x1, (double)RECT.y1,
+                              (double)(RECT.x2 - RECT.x1),
+                              (double)(RECT.y2 - RECT.y1)},
+              }));
+        });
+  }
+
   CImgBorderPassElement::SData data = {
       .deco = this,
       .a = 1.F,
+      .batch = g_pGlobalState->batcher.add(
+          this, pMonitor, m_theme, getStyle(), BLUR, instance, settled,
+          m_layout.opaque.copy().translate(instance.box.pos())),
   };
   g_pHyprRenderer->m_renderPass.add(makeUnique<CImgBorderPassElement>(data));
 }
 
-bool CImgBorder::shouldBlur() { return m_shouldBlurGlobal && m_shouldBlur; }
+SBorderStyle CImgBorder::getStyle() {
+  // Sizes come from the theme so they match its sections while a new one is
+  // still loading
+  const auto &SIZES = m_theme->key.sizes;
+  const float SCALE = m_config->scale;
+  return {
+      .borders = {(float)SIZES[0] * SCALE, (float)SIZES[1] * SCALE,
+                  (float)SIZES[2] * SCALE, (float)SIZES[3] * SCALE},
+      .scale = SCALE,
+      .smooth = m_config->smooth,
+  };
+}
 
-CBox CImgBorder::getGlobalBoundingBox(PHLMONITOR pMonitor) {
+bool CImgBorder::makeInstance(PHLMONITOR pMonitor, float a,
+                              SBorderInstance &outInstance, bool *outSettled) {
   const auto PWINDOW = m_pWindow.lock();
+  if (!PWINDOW)
+    return false;
+
+  const auto SURFACE = PWINDOW->getWindowMainSurfaceBox();
+
+  // Most frames nothing but the position changes
+  auto &stats = g_pGlobalState->layoutStats;
+  const bool SETTLED = m_layout.valid && m_layout.windowSize == SURFACE.size() &&
+                       m_layout.generation == m_layoutGeneration;
+  if (!SETTLED) {
+    updateLayout(SURFACE.size());
+    stats.recomputes++;
+  } else
+    stats.hits++;
+
+  if (outSettled)
+    *outSettled = SETTLED;
+
+  if (!m_layout.drawable)
+    return false;
+
+  outInstance = m_layout.instance;
+  outInstance.box.translate(SURFACE.pos() + getRenderOffset(PWINDOW) -
+                            pMonitor->m_position);
+  outInstance.a = a;
+  // The focused look's frames come after the others
+  const bool FOCUSED = m_theme->states > 1 &&
+                       g_pCompositor->m_lastWindow.lock() == PWINDOW;
+  const int FRAME = m_theme->frames > 1 ? m_frame % m_theme->frames : 0;
+  outInstance.frame = (FOCUSED ? m_theme->frames : 0) + FRAME;
+  return true;
+}
 
-  // Safety check for valid window
-  if (!PWINDOW) {
-    return CBox{};
-  }
-
-  // idk if I should be doing it this way but it works so...
-  CBox box = PWINDOW->getWindowMainSurfaceBox();
-  
-  // Safety check for valid scale to prevent infinite or NaN values
-  const float safeScale = (m_scale > 0 && std::isfinite(m_scale)) ? m_scale : 1.0f;
-  
-  box.width += (m_sizes[0] - m_insets[0]) * safeScale +
-               (m_sizes[1] - m_insets[1]) * safeScale;
-  box.height += (m_sizes[2] - m_insets[2]) * safeScale +
-                (m_sizes[3] - m_insets[3]) * safeScale;
-  box.translate(-Vector2D{(m_sizes[0] - m_insets[0]) * safeScale,
-                          (m_sizes[2] - m_insets[2]) * safeScale});
+static_assert(BorderLayout::SECTIONS == SECTION_COUNT);
 
-  const auto PWORKSPACE = PWINDOW->m_workspace;
-  const auto WORKSPACEOFFSET = PWORKSPACE && !m_pWindow->m_pinned
-                                   ? PWORKSPACE->m_renderOffset->value()
-                                   : Vector2D();
-  box.translate(PWINDOW->m_floatingOffset - pMonitor->m_position +
-                WORKSPACEOFFSET);
+void CImgBorder::updateLayout(const Vector2D &windowSize) {
+  CStatTimer timer(g_pGlobalState->stats, STAT_LAYOUT);
 
-  // Ensure box has valid dimensions
-  box.width = std::max(0.0, box.width);
-  box.height = std::max(0.0, box.height);
+  m_layout = {
+      .windowSize = windowSize,
+      .generation = m_layoutGeneration,
+      .valid = true,
+  };
 
-  m_bLastRelativeBox = box;
+  const auto box = getBorderBox(CBox{Vector2D{}, windowSize});
+  const auto STYLE = getStyle();
+  const auto &CONFIG = *m_config;
 
-  return box;
-}
+  const auto LENGTH = [&](eBorderSection section, bool horizontal) {
+    const auto &SEC = m_theme->sections[section];
+    return (float)(horizontal ? SEC.width : SEC.height) * STYLE.scale;
+  };
+  const BorderLayout::SParams PARAMS = {
+      .borders = STYLE.borders,
+      .placements = {(float)CONFIG.topPlacements[0],
+                     (float)CONFIG.topPlacements[1],
+                     (float)CONFIG.rightPlacements[0],
+                     (float)CONFIG.rightPlacements[1],
+                     (float)CONFIG.bottomPlacements[0],
+                     (float)CONFIG.bottomPlacements[1],
+                     (float)CONFIG.leftPlacements[0],
+                     (float)CONFIG.leftPlacements[1]},
+      .customLengths = {LENGTH(SECTION_TLC, true), LENGTH(SECTION_TRC, true),
+                        LENGTH(SECTION_RTC, false), LENGTH(SECTION_RBC, false),
+                        LENGTH(SECTION_BLC, true), LENGTH(SECTION_BRC, true),
+                        LENGTH(SECTION_LTC, false),
+                        LENGTH(SECTION_LBC, false)},
+  };
 
-// Helper function to safely render texture with UV scaling
-void CImgBorder::safeRenderTexture(SP<CTexture> tex, const CBox& renderBox, float dimension, bool isWidth, const float& a) {
-  if (!tex || dimension <= 0 || m_scale <= 0) return;
-  
-  const float texSize = isWidth ? tex->m_size.x : tex->m_size.y;
-  if (texSize <= 0) return;
-  
-  const float uvScale = dimension / (texSize * m_scale);
-  if (uvScale <= 0) return;
-  
-  if (isWidth) {
-    g_pHyprOpenGL->m_renderData.primarySurfaceUVBottomRight.x = uvScale;
-  } else {
-    g_pHyprOpenGL->m_renderData.primarySurfaceUVBottomRight.y = uvScale;
-  }
-  
-  g_pHyprOpenGL->renderTexture(tex, renderBox, {.a = a, .blur = shouldBlur(), .allowCustomUV = true, .wrapX = GL_REPEAT, .wrapY = GL_REPEAT});
-  g_pHyprOpenGL->m_renderData.primarySurfaceUVBottomRight = {1., 1.};
-}
+  // Reused, layouts are only made on the main thread
+  static BorderLayout::SBatch batch;
+  batch.resize(1);
+  batch.width[0] = box.width;
+  batch.height[0] = box.height;
+  BorderLayout::layout(PARAMS, batch);
 
-void CImgBorder::drawPass(PHLMONITOR pMonitor, const float &a) {
-  if (!m_isEnabled || m_isHidden)
+  // Too small to fit the corners
+  if (!batch.drawable[0])
     return;
 
-  const auto box = getGlobalBoundingBox(pMonitor);
+  const auto &PLACEMENTS = batch.placements;
+  m_layout.drawable = true;
+  m_layout.instance = {
+      .box = box,
+      .placementsH = {PLACEMENTS[0], PLACEMENTS[1], PLACEMENTS[4],
+                      PLACEMENTS[5]},
+      .placementsV = {PLACEMENTS[2], PLACEMENTS[3], PLACEMENTS[6],
+                      PLACEMENTS[7]},
+  };
 
-  // Safety check for minimum dimensions to prevent crashes
-  if (box.width <= 0 || box.height <= 0) {
-    return;
+  // Sections with translucent pixels, where blur can show through, and the
+  // fully opaque ones, which hide whatever is below. Opaque boxes are rounded
+  // inwards so filtered edge pixels don't count.
+  for (size_t i = 0; i < SECTION_COUNT; i++) {
+    const CBox BOX = {batch.x[i], batch.y[i], batch.w[i], batch.h[i]};
+    if (BOX.empty())
+      continue;
+
+    if (m_theme->coverage[i].translucent)
+      m_layout.blur.add(BOX);
+
+    if (m_theme->opaqueMask & (1u << i)) {
+      const auto X1 = std::ceil(BOX.x), Y1 = std::ceil(BOX.y);
+      const auto X2 = std::floor(BOX.x + BOX.width);
+      const auto Y2 = std::floor(BOX.y + BOX.height);
+      if (X2 > X1 && Y2 > Y1)
+        m_layout.opaque.add(CBox{X1, Y1, X2 - X1, Y2 - Y1});
+    }
   }
+}
 
-  // For debugging
-  // g_pHyprOpenGL->renderRect(box, CHyprColor{1.0, 0.0, 0.0, 0.5});
-  // return;
+bool CImgBorder::shouldBlur() {
+  return m_config->blurGlobal && m_config->blur;
+}
 
-  // Render the textures
-  // ------------
+CBox CImgBorder::getBorderBox(const CBox &surface) {
+  CBox box = surface;
 
-  const auto BORDER_LEFT = (float)m_sizes[0] * m_scale;
-  const auto BORDER_RIGHT = (float)m_sizes[1] * m_scale;
-  const auto BORDER_TOP = (float)m_sizes[2] * m_scale;
-  const auto BORDER_BOTTOM = (float)m_sizes[3] * m_scale;
+  // Safety check for valid scale to prevent infinite or NaN values
+  const auto &SIZES = m_config->sizes;
+  const auto &INSETS = m_config->insets;
+  const float SCALE = m_config->scale;
+  const float safeScale = (SCALE > 0 && std::isfinite(SCALE)) ? SCALE : 1.0f;
+
+  box.width += (SIZES[0] - INSETS[0]) * safeScale +
+               (SIZES[1] - INSETS[1]) * safeScale;
+  box.height += (SIZES[2] - INSETS[2]) * safeScale +
+                (SIZES[3] - INSETS[3]) * safeScale;
+  box.translate(-Vector2D{(SIZES[0] - INSETS[0]) * safeScale,
+                          (SIZES[2] - INSETS[2]) * safeScale});
 
-  const auto HEIGHT_MID = box.height - BORDER_TOP - BORDER_BOTTOM;
-  const auto WIDTH_MID = box.width - BORDER_LEFT - BORDER_RIGHT;
+  // Ensure box has valid dimensions
+  box.width = std::max(0.0, box.width);
+  box.height = std::max(0.0, box.height);
 
-  // Safety checks to prevent negative dimensions and divide by zero
-  if (HEIGHT_MID <= 0 || WIDTH_MID <= 0) {
-    return;
-  }
+  return box;
+}
 
-  // Save previous values
-
-  const auto wasUsingNearestNeighbour =
-      g_pHyprOpenGL->m_renderData.useNearestNeighbor;
-  const auto prevDiscardMode = g_pHyprOpenGL->m_renderData.discardMode;
-  const auto prevDiscardOpacity = g_pHyprOpenGL->m_renderData.discardOpacity;
-  const auto prevUVTL = g_pHyprOpenGL->m_renderData.primarySurfaceUVTopLeft;
-  const auto prevUVBR = g_pHyprOpenGL->m_renderData.primarySurfaceUVBottomRight;
-
-  g_pHyprOpenGL->m_renderData.useNearestNeighbor = !m_shouldSmooth;
-  g_pHyprOpenGL->m_renderData.discardMode = DISCARD_ALPHA;
-  g_pHyprOpenGL->m_renderData.discardOpacity = 0.01f; // Discard only nearly transparent pixels
-
-
-  // Enhanced 7-section edges
-
-  g_pHyprOpenGL->m_renderData.primarySurfaceUVTopLeft = {0, 0};
-  g_pHyprOpenGL->m_renderData.primarySurfaceUVBottomRight = {1., 1.};
-
-  // Calculate section widths and heights for positioning
-  const auto HOR_LEFT_LEFT = (float)m_hor_sizes[0] * m_scale;
-  const auto HOR_LEFT_RIGHT = (float)m_hor_sizes[1] * m_scale;
-  const auto HOR_RIGHT_LEFT = (float)m_hor_sizes[2] * m_scale;
-  const auto HOR_RIGHT_RIGHT = (float)m_hor_sizes[3] * m_scale;
-  
-  const auto VER_TOP_TOP = (float)m_ver_sizes[0] * m_scale;
-  const auto VER_TOP_BOT = (float)m_ver_sizes[1] * m_scale;
-  const auto VER_BOT_TOP = (float)m_ver_sizes[2] * m_scale;
-  const auto VER_BOT_BOT = (float)m_ver_sizes[3] * m_scale;
-
-  // Calculate middle section dimensions
-  const auto TOP_MID_WIDTH = WIDTH_MID - HOR_LEFT_LEFT - HOR_LEFT_RIGHT - HOR_RIGHT_LEFT - HOR_RIGHT_RIGHT;
-  const auto LEFT_MID_HEIGHT = HEIGHT_MID - VER_TOP_TOP - VER_TOP_BOT - VER_BOT_TOP - VER_BOT_BOT;
-
-  // TOP EDGE (7 sections with placement-based positioning)
-  const float top_start_x = box.x + BORDER_LEFT;
-  const float top_available_width = WIDTH_MID;
-  
-  // Calculate custom positions as percentages of available width
-  const float tlc_pos = (m_top_placements[0] / 100.0f) * top_available_width;
-  const float trc_pos = (m_top_placements[1] / 100.0f) * top_available_width;
-  
-  // Calculate tiling section widths based on custom positions with safety checks
-  const float tle_width = std::max(0.0f, tlc_pos);
-  const float tme_width = std::max(0.0f, trc_pos - tlc_pos - HOR_LEFT_RIGHT);
-  const float tre_width = std::max(0.0f, top_available_width - trc_pos - HOR_RIGHT_LEFT);
-  
-  float top_x = top_start_x;
-  
-  // Left edge tiling section
-  if (m_tex_tle && tle_width > 0) {
-    const CBox box_tle = {{top_x, box.y}, {tle_width, BORDER_TOP}};
-    safeRenderTexture(m_tex_tle, box_tle, tle_width, true, a);
-  }
-  
-  // Left custom section at placement position
-  if (m_tex_tlc) {
-    g_pHyprOpenGL->m_renderData.primarySurfaceUVBottomRight = {1., 1.};
-    const CBox box_tlc = {{top_start_x + tlc_pos, box.y}, {HOR_LEFT_RIGHT, BORDER_TOP}};
-    g_pHyprOpenGL->renderTexture(m_tex_tlc, box_tlc, {.a = a, .blur = shouldBlur()});
-  }
-  
-  // Middle edge tiling section
-  if (m_tex_tme && tme_width > 0) {
-    const CBox box_tme = {{top_start_x + tlc_pos + HOR_LEFT_RIGHT, box.y}, {tme_width, BORDER_TOP}};
-    safeRenderTexture(m_tex_tme, box_tme, tme_width, true, a);
-  }
-  
-  // Right custom section at placement position
-  if (m_tex_trc) {
-    g_pHyprOpenGL->m_renderData.primarySurfaceUVBottomRight = {1., 1.};
-    const CBox box_trc = {{top_start_x + trc_pos, box.y}, {HOR_RIGHT_LEFT, BORDER_TOP}};
-    g_pHyprOpenGL->renderTexture(m_tex_trc, box_trc, {.a = a, .blur = shouldBlur()});
-  }
-  
-  // Right edge tiling section
-  if (m_tex_tre && tre_width > 0) {
-    const CBox box_tre = {{top_start_x + trc_pos + HOR_RIGHT_LEFT, box.y}, {tre_width, BORDER_TOP}};
-    safeRenderTexture(m_tex_tre, box_tre, tre_width, true, a);
-  }
+Vector2D CImgBorder::getRenderOffset(PHLWINDOW pWindow) {
+  const auto PWORKSPACE = pWindow->m_workspace;
+  const auto WORKSPACEOFFSET = PWORKSPACE && !pWindow->m_pinned
+                                   ? PWORKSPACE->m_renderOffset->value()
+                                   : Vector2D();
+  return pWindow->m_floatingOffset + WORKSPACEOFFSET;
+}
 
-  // RIGHT EDGE (7 sections with placement-based positioning)
-  const float right_start_y = box.y + BORDER_TOP;
-  const float right_available_height = HEIGHT_MID;
-  
-  // Calculate custom positions as percentages of available height
-  const float rtc_pos = (m_right_placements[0] / 100.0f) * right_available_height;
-  const float rbc_pos = (m_right_placements[1] / 100.0f) * right_available_height;
-  
-  // Calculate tiling section heights based on custom positions with safety checks
-  const float rte_height = std::max(0.0f, rtc_pos);
-  const float rme_height = std::max(0.0f, rbc_pos - rtc_pos - VER_TOP_BOT);
-  const float rbe_height = std::max(0.0f, right_available_height - rbc_pos - VER_BOT_TOP);
-  
-  // Top edge tiling section
-  if (m_tex_rte && rte_height > 0) {
-    const CBox box_rte = {{box.x + box.width - BORDER_RIGHT, right_start_y}, {BORDER_RIGHT, rte_height}};
-    safeRenderTexture(m_tex_rte, box_rte, rte_height, false, a);
-  }
-  
-  // Top custom section at placement position
-  if (m_tex_rtc) {
-    g_pHyprOpenGL->m_renderData.primarySurfaceUVBottomRight = {1., 1.};
-    const CBox box_rtc = {{box.x + box.width - BORDER_RIGHT, right_start_y + rtc_pos}, {BORDER_RIGHT, VER_TOP_BOT}};
-    g_pHyprOpenGL->renderTexture(m_tex_rtc, box_rtc, {.a = a, .blur = shouldBlur()});
-  }
-  
-  // Middle edge tiling section
-  if (m_tex_rme && rme_height > 0) {
-    const CBox box_rme = {{box.x + box.width - BORDER_RIGHT, right_start_y + rtc_pos + VER_TOP_BOT}, {BORDER_RIGHT, rme_height}};
-    safeRenderTexture(m_tex_rme, box_rme, rme_height, false, a);
-  }
-  
-  // Bottom custom section at placement position
-  if (m_tex_rbc) {
-    g_pHyprOpenGL->m_renderData.primarySurfaceUVBottomRight = {1., 1.};
-    const CBox box_rbc = {{box.x + box.width - BORDER_RIGHT, right_start_y + rbc_pos}, {BORDER_RIGHT, VER_BOT_TOP}};
-    g_pHyprOpenGL->renderTexture(m_tex_rbc, box_rbc, {.a = a, .blur = shouldBlur()});
-  }
-  
-  // Bottom edge tiling section
-  if (m_tex_rbe && rbe_height > 0) {
-    const CBox box_rbe = {{box.x + box.width - BORDER_RIGHT, right_start_y + rbc_pos + VER_BOT_TOP}, {BORDER_RIGHT, rbe_height}};
-    safeRenderTexture(m_tex_rbe, box_rbe, rbe_height, false, a);
-  }
+CBox CImgBorder::getGlobalBoundingBox(PHLMONITOR pMonitor) {
+  const auto PWINDOW = m_pWindow.lock();
 
-  // BOTTOM EDGE (7 sections with placement-based positioning)
-  const float bottom_start_x = box.x + BORDER_LEFT;
-  const float bottom_available_width = WIDTH_MID;
-  
-  // Calculate custom positions as percentages of available width
-  const float blc_pos = (m_bottom_placements[0] / 100.0f) * bottom_available_width;
-  const float brc_pos = (m_bottom_placements[1] / 100.0f) * bottom_available_width;
-  
-  // Calculate tiling section widths based on custom positions with safety checks
-  const float ble_width = std::max(0.0f, blc_pos);
-  const float bme_width = std::max(0.0f, brc_pos - blc_pos - HOR_LEFT_RIGHT);
-  const float bre_width = std::max(0.0f, bottom_available_width - brc_pos - HOR_RIGHT_LEFT);
-  
-  // Left edge tiling section
-  if (m_tex_ble && ble_width > 0) {
-    const CBox box_ble = {{bottom_start_x, box.y + box.height - BORDER_BOTTOM}, {ble_width, BORDER_BOTTOM}};
-    safeRenderTexture(m_tex_ble, box_ble, ble_width, true, a);
-  }
-  
-  // Left custom section at placement position
-  if (m_tex_blc) {
-    g_pHyprOpenGL->m_renderData.primarySurfaceUVBottomRight = {1., 1.};
-    const CBox box_blc = {{bottom_start_x + blc_pos, box.y + box.height - BORDER_BOTTOM}, {HOR_LEFT_RIGHT, BORDER_BOTTOM}};
-    g_pHyprOpenGL->renderTexture(m_tex_blc, box_blc, {.a = a, .blur = shouldBlur()});
-  }
-  
-  // Middle edge tiling section
-  if (m_tex_bme && bme_width > 0) {
-    const CBox box_bme = {{bottom_start_x + blc_pos + HOR_LEFT_RIGHT, box.y + box.height - BORDER_BOTTOM}, {bme_width, BORDER_BOTTOM}};
-    safeRenderTexture(m_tex_bme, box_bme, bme_width, true, a);
-  }
-  
-  // Right custom section at placement position
-  if (m_tex_brc) {
-    g_pHyprOpenGL->m_renderData.primarySurfaceUVBottomRight = {1., 1.};
-    const CBox box_brc = {{bottom_start_x + brc_pos, box.y + box.height - BORDER_BOTTOM}, {HOR_RIGHT_LEFT, BORDER_BOTTOM}};
-    g_pHyprOpenGL->renderTexture(m_tex_brc, box_brc, {.a = a, .blur = shouldBlur()});
-  }
-  
-  // Right edge tiling section
-  if (m_tex_bre && bre_width > 0) {
-    const CBox box_bre = {{bottom_start_x + brc_pos + HOR_RIGHT_LEFT, box.y + box.height - BORDER_BOTTOM}, {bre_width, BORDER_BOTTOM}};
-    safeRenderTexture(m_tex_bre, box_bre, bre_width, true, a);
+  // Safety check for valid window
+  if (!PWINDOW) {
+    return CBox{};
   }
 
-  // LEFT EDGE (7 sections with placement-based positioning)
-  const float left_start_y = box.y + BORDER_TOP;
-  const float left_available_height = HEIGHT_MID;
-  
-  // Calculate custom positions as percentages of available height
-  const float ltc_pos = (m_left_placements[0] / 100.0f) * left_available_height;
-  const float lbc_pos = (m_left_placements[1] / 100.0f) * left_available_height;
-  
-  // Calculate tiling section heights based on custom positions with safety checks
-  const float lte_height = std::max(0.0f, ltc_pos);
-  const float lme_height = std::max(0.0f, lbc_pos - ltc_pos - VER_TOP_BOT);
-  const float lbe_height = std::max(0.0f, left_available_height - lbc_pos - VER_BOT_TOP);
-  
-  // Top edge tiling section
-  if (m_tex_lte && lte_height > 0) {
-    const CBox box_lte = {{box.x, left_start_y}, {BORDER_LEFT, lte_height}};
-    safeRenderTexture(m_tex_lte, box_lte, lte_height, false, a);
-  }
-  
-  // Top custom section at placement position
-  if (m_tex_ltc) {
-    g_pHyprOpenGL->m_renderData.primarySurfaceUVBottomRight = {1., 1.};
-    const CBox box_ltc = {{box.x, left_start_y + ltc_pos}, {BORDER_LEFT, VER_TOP_BOT}};
-    g_pHyprOpenGL->renderTexture(m_tex_ltc, box_ltc, {.a = a, .blur = shouldBlur()});
-  }
-  
-  // Middle edge tiling section
-  if (m_tex_lme && lme_height > 0) {
-    const CBox box_lme = {{box.x, left_start_y + ltc_pos + VER_TOP_BOT}, {BORDER_LEFT, lme_height}};
-    safeRenderTexture(m_tex_lme, box_lme, lme_height, false, a);
-  }
-  
-  // Bottom custom section at placement position
-  if (m_tex_lbc) {
-    g_pHyprOpenGL->m_renderData.primarySurfaceUVBottomRight = {1., 1.};
-    const CBox box_lbc = {{box.x, left_start_y + lbc_pos}, {BORDER_LEFT, VER_BOT_TOP}};
-    g_pHyprOpenGL->renderTexture(m_tex_lbc, box_lbc, {.a = a, .blur = shouldBlur()});
-  }
-  
-  // Bottom edge tiling section
-  if (m_tex_lbe && lbe_height > 0) {
-    const CBox box_lbe = {{box.x, left_start_y + lbc_pos + VER_BOT_TOP}, {BORDER_LEFT, lbe_height}};
-    safeRenderTexture(m_tex_lbe, box_lbe, lbe_height, false, a);
-  }
+  // idk if I should be doing it this way but it works so...
+  auto box = getBorderBox(PWINDOW->getWindowMainSurfaceBox());
+  box.translate(getRenderOffset(PWINDOW) - pMonitor->m_position);
+  return box;
+}
 
-  // Corners
+eDecorationType CImgBorder::getDecorationType() { return DECORATION_CUSTOM; }
 
-  if (m_tex_br) {
-    const CBox box_br = {
-        {box.x + box.width - BORDER_RIGHT, box.y + box.height - BORDER_BOTTOM},
-        {BORDER_RIGHT, BORDER_BOTTOM}};
-      g_pHyprOpenGL->renderTexture(m_tex_br, box_br, {.a = a});
-  }
+void CImgBorder::updateWindow(PHLWINDOW pWindow) { damageEntire(); }
 
-  if (m_tex_bl) {
-    const CBox box_bl = {{box.x, box.y + box.height - BORDER_BOTTOM},
-                         {BORDER_LEFT, BORDER_BOTTOM}};
-      g_pHyprOpenGL->renderTexture(m_tex_bl, box_bl, {.a = a});
-  }
+CRegion CImgBorder::getRing() {
+  const auto PWINDOW = m_pWindow.lock();
+  if (!PWINDOW || !m_isEnabled || m_isHidden)
+    return {};
 
-  if (m_tex_tl) {
-    const CBox box_tl = {box.pos(), {BORDER_LEFT, BORDER_TOP}};
-      g_pHyprOpenGL->renderTexture(m_tex_tl, box_tl, {.a = a});
-  }
+  const float CONFIGSCALE = m_config->scale;
+  const float SCALE =
+      (CONFIGSCALE > 0 && std::isfinite(CONFIGSCALE)) ? CONFIGSCALE : 1.0f;
 
-  if (m_tex_tr) {
-    const CBox box_tr = {{box.x + box.width - BORDER_RIGHT, box.y},
-                         {BORDER_RIGHT, BORDER_TOP}};
-        g_pHyprOpenGL->renderTexture(m_tex_tr, box_tr, {.a = a});
-  }
+  // Same box as getGlobalBoundingBox, but in layout coordinates
+  auto box = getBorderBox(PWINDOW->getWindowMainSurfaceBox());
+  box.translate(getRenderOffset(PWINDOW));
 
-  // Restore previous values
+  // Thickness as drawn, which follows the theme on screen
+  const auto SIZE = [&](int i) {
+    return (m_theme ? m_theme->key.sizes[i] : m_config->sizes[i]) * SCALE;
+  };
+  CBox inner = {box.x + SIZE(0), box.y + SIZE(2),
+                box.width - SIZE(0) - SIZE(1), box.height - SIZE(2) - SIZE(3)};
 
-  g_pHyprOpenGL->m_renderData.useNearestNeighbor = wasUsingNearestNeighbour;
-  g_pHyprOpenGL->m_renderData.discardMode = prevDiscardMode;
-  g_pHyprOpenGL->m_renderData.discardOpacity = prevDiscardOpacity;
+  // A little slack for filtering and rounding on both sides
+  CRegion ring = box.expand(2);
+  if (inner.width > 4 && inner.height > 4)
+    ring.subtract(inner.expand(-2));
 
-  g_pHyprOpenGL->m_renderData.primarySurfaceUVTopLeft = prevUVTL;
-  g_pHyprOpenGL->m_renderData.primarySurfaceUVBottomRight = prevUVBR;
+  return ring;
 }
 
-eDecorationType CImgBorder::getDecorationType() { return DECORATION_CUSTOM; }
-
-void CImgBorder::updateWindow(PHLWINDOW pWindow) { damageEntire(); }
-
 void CImgBorder::damageEntire() {
-  g_pHyprRenderer->damageBox(m_bLastRelativeBox.expand(2));
+  // Where it was and where it is now, so moves don't leave anything behind
+  const auto RING = getRing();
+  g_pHyprRenderer->damageRegion(m_lastRing.copy().add(RING));
+  m_lastRing = RING;
 }
 
 eDecorationLayer CImgBorder::getDecorationLayer() {
@@ -419,488 +328,152 @@ uint64_t CImgBorder::getDecorationFlags() {
   return DECORATION_PART_OF_MAIN_WINDOW;
 }
 
-template<int N>
-bool parseInts(Hyprlang::STRING const *str, int (&outArr)[N]) {
-  auto strStream = std::stringstream(*str);
-  for (int i = 0; i < N; i++) {
-    try {
-      std::string intStr;
-      std::getline(strStream, intStr, ',');
-      outArr[i] = std::stoi(intStr);
-    } catch (...) {
-      return false;
-    }
-  }
-  return true;
-}
-
-// TODO better error handling
-void CImgBorder::updateConfig() {
-  // Read config
-  // ------------
+void CImgBorder::applyConfig(const SP<const SConfigSnapshot> &config) {
+  // The named theme the rules ask for, if the config has it
+  const auto &NEXT = ConfigUtils::resolve(config, m_themeName);
+  if (!m_themeName.empty() && NEXT == config)
+    Debug::log(ERR, "[imgborders] no theme called {}", m_themeName);
 
-  // hidden
-  m_isEnabled = **(Hyprlang::INT *const *)HyprlandAPI::getConfigValue(
-                      PHANDLE, "plugin:imgborders:enabled")
-                      ->getDataStaticPtr();
-  if (!m_isEnabled) {
+  const auto CHANGES = ConfigUtils::diff(m_config.get(), *NEXT);
+  m_config = NEXT;
+  m_isEnabled = m_config->enabled;
+  if (CHANGES == CONFIG_UNCHANGED)
     return;
-  }
 
-  // image
-  const auto texSrc = (Hyprlang::STRING const *)HyprlandAPI::getConfigValue(
-                          PHANDLE, "plugin:imgborders:image")
-                          ->getDataStaticPtr();
-  wordexp_t p;
-  wordexp(*texSrc, &p, 0);
-  std::string texSrcExpanded;
-  for (size_t i = 0; i < p.we_wordc; i++)
-    texSrcExpanded.append(p.we_wordv[i]);
-  wordfree(&p);
-  if (!std::filesystem::exists(texSrcExpanded)) {
-    HyprlandAPI::addNotification(
-        PHANDLE,
-        std::format("[imgborders] {} image at doesn't exist", texSrcExpanded),
-        CHyprColor{1.0, 0.1, 0.1, 1.0}, 5000);
-    m_isEnabled = false;
-    return;
-  }
+  // Placements, insets and scale only move things around on the same theme
+  m_layoutGeneration++;
 
-  // sizes
-  const auto sizesStr = (Hyprlang::STRING const *)HyprlandAPI::getConfigValue(
-                            PHANDLE, "plugin:imgborders:sizes")
-                            ->getDataStaticPtr();
-  if (!sizesStr || std::string(*sizesStr).empty()) {
-    HyprlandAPI::addNotification(PHANDLE,
-                                 "[imgborders] missing sizes in config",
-                                 CHyprColor{1.0, 0.1, 0.1, 1.0}, 5000);
-    m_isEnabled = false;                             
-    return;
-  }
-  if (!parseInts(sizesStr, m_sizes)) {
-    HyprlandAPI::addNotification(PHANDLE,
-                                 "[imgborders] invalid sizes in config",
-                                 CHyprColor{1.0, 0.1, 0.1, 1.0}, 5000);
-    m_isEnabled = false;
-    return;
+  // Windows sharing the image and slices share the textures too, so this only
+  // decodes on the first window after a change. Decoding happens in the
+  // background, until it's done the old theme stays on screen. Borders that
+  // haven't been drawn yet, or were released, pick it up on their next draw.
+  if (m_isEnabled && (CHANGES & CONFIG_THEME)) {
+    m_themeKey = m_config->themeKey;
+    if (m_theme || m_nextTheme)
+      acquireTheme();
   }
 
-  // 7x7 horsizes
-  const auto horsizesStr = (Hyprlang::STRING const *)HyprlandAPI::getConfigValue(
-                            PHANDLE, "plugin:imgborders:horsizes")
-                            ->getDataStaticPtr();
-  if (!horsizesStr || std::string(*horsizesStr).empty()) {
-    HyprlandAPI::addNotification(PHANDLE,
-                                 "[imgborders] missing horsizes in config",
-                                 CHyprColor{1.0, 0.1, 0.1, 1.0}, 5000);
-    m_isEnabled = false;
-    return;
-  }
-  if (!parseInts(horsizesStr, m_hor_sizes)) {
-    HyprlandAPI::addNotification(PHANDLE,
-                                 "[imgborders] invalid horsizes in config",
-                                 CHyprColor{1.0, 0.1, 0.1, 1.0}, 5000);
-    m_isEnabled = false;
-    return;
-  }
+  if (CHANGES & CONFIG_LAYOUT)
+    g_pDecorationPositioner->repositionDeco(this);
+}
 
-    // 7x7 versizes
-  const auto versizesStr = (Hyprlang::STRING const *)HyprlandAPI::getConfigValue(
-                            PHANDLE, "plugin:imgborders:versizes")
-                            ->getDataStaticPtr();
-  if (!versizesStr || std::string(*versizesStr).empty()) {
-    HyprlandAPI::addNotification(PHANDLE,
-                                 "[imgborders] missing versizes in config",
-                                 CHyprColor{1.0, 0.1, 0.1, 1.0}, 5000);
-    m_isEnabled = false;
-    return;
-  }
-  if (!parseInts(versizesStr, m_ver_sizes)) {
-    HyprlandAPI::addNotification(PHANDLE,
-                                 "[imgborders] invalid versizes in config",
-                                 CHyprColor{1.0, 0.1, 0.1, 1.0}, 5000);
-    m_isEnabled = false;
-    return;
-  }
+void CImgBorder::acquireTheme() {
+  auto theme = g_pGlobalState->themes.get(m_themeKey);
+  if (theme->atlas) {
+    m_theme = std::move(theme);
+    m_nextTheme.reset();
+  } else
+    m_nextTheme = std::move(theme);
+}
 
-  // Independent edge placements
-  const auto topplacementsStr = (Hyprlang::STRING const *)HyprlandAPI::getConfigValue(
-                            PHANDLE, "plugin:imgborders:topplacements")
-                            ->getDataStaticPtr();
-  if (!topplacementsStr || std::string(*topplacementsStr).empty()) {
-    HyprlandAPI::addNotification(PHANDLE,
-                                 "[imgborders] missing topplacements in config",
-                                 CHyprColor{1.0, 0.1, 0.1, 1.0}, 5000);
-    m_isEnabled = false;
-    return;
-  }
-  if (!parseInts(topplacementsStr, m_top_placements)) {
-    HyprlandAPI::addNotification(PHANDLE,
-                                 "[imgborders] invalid topplacements in config",
-                                 CHyprColor{1.0, 0.1, 0.1, 1.0}, 5000);
-    m_isEnabled = false;
-    return;
-  }
+bool CImgBorder::releaseIfIdle(std::chrono::steady_clock::time_point now,
+                               std::chrono::seconds idle) {
+  if ((!m_theme && !m_nextTheme) || now - m_lastDrawn < idle)
+    return false;
 
-  const auto bottomplacementsStr = (Hyprlang::STRING const *)HyprlandAPI::getConfigValue(
-                            PHANDLE, "plugin:imgborders:bottomplacements")
-                            ->getDataStaticPtr();
-  if (!bottomplacementsStr || std::string(*bottomplacementsStr).empty()) {
-    HyprlandAPI::addNotification(PHANDLE,
-                                 "[imgborders] missing bottomplacements in config",
-                                 CHyprColor{1.0, 0.1, 0.1, 1.0}, 5000);
-    m_isEnabled = false;
-    return;
-  }
-  if (!parseInts(bottomplacementsStr, m_bottom_placements)) {
-    HyprlandAPI::addNotification(PHANDLE,
-                                 "[imgborders] invalid bottomplacements in config",
-                                 CHyprColor{1.0, 0.1, 0.1, 1.0}, 5000);
-    m_isEnabled = false;
-    return;
-  }
+  m_theme.reset();
+  m_nextTheme.reset();
+  m_layout.valid = false;
+  return true;
+}
 
-  const auto leftplacementsStr = (Hyprlang::STRING const *)HyprlandAPI::getConfigValue(
-                            PHANDLE, "plugin:imgborders:leftplacements")
-                            ->getDataStaticPtr();
-  if (!leftplacementsStr || std::string(*leftplacementsStr).empty()) {
-    HyprlandAPI::addNotification(PHANDLE,
-                                 "[imgborders] missing leftplacements in config",
-                                 CHyprColor{1.0, 0.1, 0.1, 1.0}, 5000);
-    m_isEnabled = false;
-    return;
-  }
-  if (!parseInts(leftplacementsStr, m_left_placements)) {
-    HyprlandAPI::addNotification(PHANDLE,
-                                 "[imgborders] invalid leftplacements in config",
-                                 CHyprColor{1.0, 0.1, 0.1, 1.0}, 5000);
-    m_isEnabled = false;
-    return;
-  }
+// Borders not drawn for this long are taken to be out of sight
+constexpr auto UNSEEN_AFTER = std::chrono::seconds(1);
 
-  const auto rightplacementsStr = (Hyprlang::STRING const *)HyprlandAPI::getConfigValue(
-                            PHANDLE, "plugin:imgborders:rightplacements")
-                            ->getDataStaticPtr();
-  if (!rightplacementsStr || std::string(*rightplacementsStr).empty()) {
-    HyprlandAPI::addNotification(PHANDLE,
-                                 "[imgborders] missing rightplacements in config",
-                                 CHyprColor{1.0, 0.1, 0.1, 1.0}, 5000);
-    m_isEnabled = false;
-    return;
-  }
-  if (!parseInts(rightplacementsStr, m_right_placements)) {
-    HyprlandAPI::addNotification(PHANDLE,
-                                 "[imgborders] invalid rightplacements in config",
-                                 CHyprColor{1.0, 0.1, 0.1, 1.0}, 5000);
-    m_isEnabled = false;
-    return;
-  }
+bool CImgBorder::shouldAnimate(std::chrono::steady_clock::time_point now) {
+  const auto PWINDOW = m_pWindow.lock();
+  if (!PWINDOW || !m_isEnabled || m_isHidden ||
+      now - m_lastDrawn > UNSEEN_AFTER)
+    return false;
 
-  // insets
-  const auto insetsStr = (Hyprlang::STRING const *)HyprlandAPI::getConfigValue(
-                             PHANDLE, "plugin:imgborders:insets")
-                             ->getDataStaticPtr();
-  if (!insetsStr || std::string(*insetsStr).empty()) {
-    HyprlandAPI::addNotification(
-        PHANDLE,
-        "[imgborders] missing insets in config. This should never happen!",
-        CHyprColor{1.0, 0.1, 0.1, 1.0}, 5000);
-    m_isEnabled = false;
-    return;
-  }
-  if (!parseInts(insetsStr, m_insets)) {
-    HyprlandAPI::addNotification(PHANDLE,
-                                 "[imgborders] invalid insets in config",
-                                 CHyprColor{1.0, 0.1, 0.1, 1.0}, 5000);
-    m_isEnabled = false;
-    return;
-  }
+  if (g_pCompositor->m_lastWindow.lock() != PWINDOW)
+    return false;
 
-  // scale
-  m_scale = **(Hyprlang::FLOAT *const *)HyprlandAPI::getConfigValue(
-                  PHANDLE, "plugin:imgborders:scale")
-                  ->getDataStaticPtr();
-
-  // smooth
-  m_shouldSmooth = **(Hyprlang::INT *const *)HyprlandAPI::getConfigValue(
-                         PHANDLE, "plugin:imgborders:smooth")
-                         ->getDataStaticPtr();
-
-  // blur
-  m_shouldBlurGlobal = **(Hyprlang::INT *const *)HyprlandAPI::getConfigValue(
-                             PHANDLE, "decoration:blur:enabled")
-                             ->getDataStaticPtr();
-  m_shouldBlur = **(Hyprlang::INT *const *)HyprlandAPI::getConfigValue(
-                       PHANDLE, "plugin:imgborders:blur")
-                       ->getDataStaticPtr();
-
-  // Create textures
-  // ------------
-
-  // But first delete old textures - ensure we're not in a render pass
-  // Store old textures to destroy after nullifying pointers to prevent race conditions
-  std::vector<SP<CTexture>> texturesToDestroy;
-  
-  if (m_tex_tl) {
-    texturesToDestroy.push_back(m_tex_tl);
-    m_tex_tl = nullptr;
-  }
-  if (m_tex_tr) {
-    texturesToDestroy.push_back(m_tex_tr);
-    m_tex_tr = nullptr;
-  }
-  if (m_tex_br) {
-    texturesToDestroy.push_back(m_tex_br);
-    m_tex_br = nullptr;
-  }
-  if (m_tex_bl) {
-    texturesToDestroy.push_back(m_tex_bl);
-    m_tex_bl = nullptr;
-  }
+  // Hidden workspace, or covered by a fullscreen window. Other windows on
+  // top aren't checked, a border under them goes on animating.
+  const auto PWORKSPACE = PWINDOW->m_workspace;
+  if (!PWORKSPACE || !PWORKSPACE->isVisible())
+    return false;
+  return !PWORKSPACE->m_hasFullscreenWindow || PWINDOW->isFullscreen() ||
+         PWINDOW->m_createdOverFullscreen;
+}
 
-  // Continue collecting textures to destroy
-  if (m_tex_tle) {
-    texturesToDestroy.push_back(m_tex_tle);
-    m_tex_tle = nullptr;
-  }
-  if (m_tex_tlc) {
-    texturesToDestroy.push_back(m_tex_tlc);
-    m_tex_tlc = nullptr;
-  }
-  if (m_tex_tme) {
-    texturesToDestroy.push_back(m_tex_tme);
-    m_tex_tme = nullptr;
-  }
-  if (m_tex_trc) {
-    texturesToDestroy.push_back(m_tex_trc);
-    m_tex_trc = nullptr;
-  }
-  if (m_tex_tre) {
-    texturesToDestroy.push_back(m_tex_tre);
-    m_tex_tre = nullptr;
+float CImgBorder::animate(std::chrono::steady_clock::time_point now) {
+  const float FPS = m_config ? m_config->fps : 0.F;
+  if (!m_theme || m_theme->frames <= 1 || FPS <= 0.F || !shouldAnimate(now)) {
+    m_animating = false;
+    return 0.F;
   }
 
-  if (m_tex_rte) {
-    texturesToDestroy.push_back(m_tex_rte);
-    m_tex_rte = nullptr;
-  }
-  if (m_tex_rtc) {
-    texturesToDestroy.push_back(m_tex_rtc);
-    m_tex_rtc = nullptr;
-  }
-  if (m_tex_rme) {
-    texturesToDestroy.push_back(m_tex_rme);
-    m_tex_rme = nullptr;
-  }
-  if (m_tex_rbc) {
-    texturesToDestroy.push_back(m_tex_rbc);
-    m_tex_rbc = nullptr;
-  }
-  if (m_tex_rbe) {
-    texturesToDestroy.push_back(m_tex_rbe);
-    m_tex_rbe = nullptr;
-  }
-  
-  if (m_tex_ble) {
-    texturesToDestroy.push_back(m_tex_ble);
-    m_tex_ble = nullptr;
-  }
-  if (m_tex_blc) {
-    texturesToDestroy.push_back(m_tex_blc);
-    m_tex_blc = nullptr;
-  }
-  if (m_tex_bme) {
-    texturesToDestroy.push_back(m_tex_bme);
-    m_tex_bme = nullptr;
-  }
-  if (m_tex_brc) {
-    texturesToDestroy.push_back(m_tex_brc);
-    m_tex_brc = nullptr;
-  }
-  if (m_tex_bre) {
-    texturesToDestroy.push_back(m_tex_bre);
-    m_tex_bre = nullptr;
-  }
-  
-  if (m_tex_lte) {
-    texturesToDestroy.push_back(m_tex_lte);
-    m_tex_lte = nullptr;
-  }
-  if (m_tex_ltc) {
-    texturesToDestroy.push_back(m_tex_ltc);
-    m_tex_ltc = nullptr;
-  }
-  if (m_tex_lme) {
-    texturesToDestroy.push_back(m_tex_lme);
-    m_tex_lme = nullptr;
-  }
-  if (m_tex_lbc) {
-    texturesToDestroy.push_back(m_tex_lbc);
-    m_tex_lbc = nullptr;
-  }
-  if (m_tex_lbe) {
-    texturesToDestroy.push_back(m_tex_lbe);
-    m_tex_lbe = nullptr;
+  // Picks up from the frame it paused on
+  using SECONDS = std::chrono::duration<double>;
+  if (!m_animating) {
+    m_frameStart =
+        now - std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                  SECONDS(m_frame / FPS));
+    m_animating = true;
   }
 
-  if (m_tex_l) {
-    texturesToDestroy.push_back(m_tex_l);
-    m_tex_l = nullptr;
+  const double ELAPSED = SECONDS(now - m_frameStart).count();
+  const int FRAME = (int)(ELAPSED * FPS) % m_theme->frames;
+  if (FRAME != m_frame) {
+    m_frame = FRAME;
+    damageEntire();
   }
-  if (m_tex_t) {
-    texturesToDestroy.push_back(m_tex_t);
-    m_tex_t = nullptr;
-  }
-  if (m_tex_b) {
-    texturesToDestroy.push_back(m_tex_b);
-    m_tex_b = nullptr;
-  }
-  if (m_tex_r) {
-    texturesToDestroy.push_back(m_tex_r);
-    m_tex_r = nullptr;
-  }
-  // Now safely destroy all old textures after nullifying pointers
-  for (auto& tex : texturesToDestroy) {
-    if (tex) {
-      tex->destroyTexture();
-    }
-  }
-  texturesToDestroy.clear();
-
-  auto tex = ImgUtils::load(texSrcExpanded);
-
-  const auto BORDER_LEFT = (float)m_sizes[0];
-  const auto BORDER_RIGHT = (float)m_sizes[1];
-  const auto BORDER_TOP = (float)m_sizes[2];
-  const auto BORDER_BOTTOM = (float)m_sizes[3];
-
-  const auto WIDTH_MID = tex->m_size.x - BORDER_LEFT - BORDER_RIGHT;
-  const auto HEIGHT_MID = tex->m_size.y - BORDER_TOP - BORDER_BOTTOM;
-
-  const auto BORDER_VERTOPTOP = (float)m_ver_sizes[0];
-  const auto BORDER_VERTOPBOT = (float)m_ver_sizes[1];
-  const auto BORDER_VERBOTTOP = (float)m_ver_sizes[2];
-  const auto BORDER_VERBOTBOT = (float)m_ver_sizes[3];
-  
-  const auto BORDER_HORLEFTLEFT = (float)m_hor_sizes[0];
-  const auto BORDER_HORLEFTRIGHT = (float)m_hor_sizes[1];
-  const auto BORDER_HORRIGHTLEFT = (float)m_hor_sizes[2];
-  const auto BORDER_HORRIGHTRIGHT = (float)m_hor_sizes[3];
-
-
-  m_tex_tl = ImgUtils::sliceTexture(
-      tex, {{0., 0.}, 
-            {BORDER_LEFT, BORDER_TOP}});
-
-  m_tex_t  = ImgUtils::sliceTexture(
-      tex, {{BORDER_LEFT, 0.}, 
-            {WIDTH_MID, BORDER_TOP}});
-
-  m_tex_tr = ImgUtils::sliceTexture(
-      tex, {{tex->m_size.x - BORDER_RIGHT, 0.}, 
-            {BORDER_RIGHT, BORDER_TOP}});
-
-  m_tex_r  = ImgUtils::sliceTexture(
-      tex, {{tex->m_size.x - BORDER_RIGHT, BORDER_TOP},
-            {BORDER_RIGHT, tex->m_size.y - BORDER_TOP - BORDER_BOTTOM}});
-
-  m_tex_br = ImgUtils::sliceTexture(
-      tex, {{tex->m_size.x - BORDER_RIGHT, tex->m_size.y - BORDER_BOTTOM},
-            {BORDER_RIGHT, BORDER_BOTTOM}});
-
-  m_tex_b  = ImgUtils::sliceTexture(
-      tex, {{BORDER_LEFT, tex->m_size.y - BORDER_BOTTOM},
-            {tex->m_size.x - BORDER_LEFT - BORDER_RIGHT, BORDER_BOTTOM}});
-
-  m_tex_bl = ImgUtils::sliceTexture(
-      tex, {{0., tex->m_size.y - BORDER_BOTTOM}, 
-            {BORDER_LEFT, BORDER_BOTTOM}});
-
-  m_tex_l  = ImgUtils::sliceTexture(
-      tex, {{0., BORDER_TOP},
-            {BORDER_LEFT, tex->m_size.y - BORDER_TOP - BORDER_BOTTOM}});
-// 7x7 FUNCTIONALITY
-// TOP EDGE - Corrected definitions
-  m_tex_tle = ImgUtils::sliceTexture(
-      tex, {{BORDER_LEFT, 0.},
-            {BORDER_HORLEFTLEFT, BORDER_TOP}});
-  m_tex_tlc = ImgUtils::sliceTexture(
-      tex, {{BORDER_LEFT + BORDER_HORLEFTLEFT, 0.},
-            {BORDER_HORLEFTRIGHT, BORDER_TOP}});
-  m_tex_tme = ImgUtils::sliceTexture(
-      tex, {{BORDER_LEFT + BORDER_HORLEFTLEFT + BORDER_HORLEFTRIGHT, 0.},
-            {tex->m_size.x - BORDER_RIGHT - BORDER_HORRIGHTRIGHT - BORDER_HORRIGHTLEFT - BORDER_LEFT - BORDER_HORLEFTLEFT - BORDER_HORLEFTRIGHT, BORDER_TOP}});
-  m_tex_trc = ImgUtils::sliceTexture(
-      tex, {{tex->m_size.x - BORDER_RIGHT - BORDER_HORRIGHTRIGHT - BORDER_HORRIGHTLEFT, 0.},
-            {BORDER_HORRIGHTLEFT, BORDER_TOP}});
-  m_tex_tre = ImgUtils::sliceTexture(
-      tex, {{tex->m_size.x - BORDER_RIGHT - BORDER_HORRIGHTRIGHT, 0.},
-            {BORDER_HORRIGHTRIGHT, BORDER_TOP}});
-// RIGHT - Fixed coordinate calculations
-  m_tex_rte = ImgUtils::sliceTexture(
-      tex, {{tex->m_size.x - BORDER_RIGHT, BORDER_TOP},
-            {BORDER_RIGHT, BORDER_VERTOPTOP}});
-  m_tex_rtc = ImgUtils::sliceTexture(
-      tex, {{tex->m_size.x - BORDER_RIGHT, BORDER_TOP + BORDER_VERTOPTOP},
-            {BORDER_RIGHT, BORDER_VERTOPBOT}});
-  m_tex_rme = ImgUtils::sliceTexture(
-      tex, {{tex->m_size.x - BORDER_RIGHT, BORDER_TOP + BORDER_VERTOPTOP + BORDER_VERTOPBOT},
-            {BORDER_RIGHT, tex->m_size.y - BORDER_BOTTOM - BORDER_VERBOTBOT - BORDER_VERBOTTOP - BORDER_TOP - BORDER_VERTOPTOP - BORDER_VERTOPBOT}});
-  m_tex_rbc = ImgUtils::sliceTexture(
-      tex, {{tex->m_size.x - BORDER_RIGHT, tex->m_size.y - BORDER_BOTTOM - BORDER_VERBOTBOT - BORDER_VERBOTTOP},
-            {BORDER_RIGHT, BORDER_VERBOTTOP}});
-  m_tex_rbe = ImgUtils::sliceTexture(
-      tex, {{tex->m_size.x - BORDER_RIGHT, tex->m_size.y - BORDER_BOTTOM - BORDER_VERBOTBOT},
-            {BORDER_RIGHT, BORDER_VERBOTBOT}});
-// BOTTOM
-  m_tex_ble = ImgUtils::sliceTexture(
-      tex, {{BORDER_LEFT, tex->m_size.y - BORDER_BOTTOM},
-            {BORDER_HORLEFTLEFT, BORDER_BOTTOM}});
-  m_tex_blc = ImgUtils::sliceTexture(
-      tex, {{BORDER_LEFT + BORDER_HORLEFTLEFT, tex->m_size.y - BORDER_BOTTOM},
-            {BORDER_HORLEFTRIGHT, BORDER_BOTTOM}});
-  m_tex_bme = ImgUtils::sliceTexture(
-      tex, {{BORDER_LEFT + BORDER_HORLEFTLEFT + BORDER_HORLEFTRIGHT, tex->m_size.y - BORDER_BOTTOM},
-            {tex->m_size.x - BORDER_RIGHT - BORDER_HORRIGHTRIGHT - BORDER_HORRIGHTLEFT - BORDER_LEFT - BORDER_HORLEFTLEFT - BORDER_HORLEFTRIGHT, BORDER_BOTTOM}});
-  m_tex_brc = ImgUtils::sliceTexture(
-      tex, {{tex->m_size.x - BORDER_RIGHT - BORDER_HORRIGHTRIGHT - BORDER_HORRIGHTLEFT, tex->m_size.y - BORDER_BOTTOM},
-            {BORDER_HORRIGHTLEFT, BORDER_BOTTOM}});
-  m_tex_bre = ImgUtils::sliceTexture(
-      tex, {{tex->m_size.x - BORDER_RIGHT - BORDER_HORRIGHTRIGHT, tex->m_size.y - BORDER_BOTTOM},
-            {BORDER_HORRIGHTRIGHT, BORDER_BOTTOM}});
-// LEFT
-  m_tex_lte = ImgUtils::sliceTexture(
-      tex, {{0., BORDER_TOP},
-            {BORDER_LEFT, BORDER_VERTOPTOP}});
-  m_tex_ltc = ImgUtils::sliceTexture(
-      tex, {{0., BORDER_TOP + BORDER_VERTOPTOP},
-            {BORDER_LEFT, BORDER_VERTOPBOT}});
-  m_tex_lme = ImgUtils::sliceTexture(
-      tex, {{0., BORDER_TOP + BORDER_VERTOPTOP + BORDER_VERTOPBOT},
-            {BORDER_LEFT, tex->m_size.y - BORDER_BOTTOM - BORDER_VERBOTBOT - BORDER_VERBOTTOP - BORDER_TOP - BORDER_VERTOPTOP - BORDER_VERTOPBOT}});
-  m_tex_lbc = ImgUtils::sliceTexture(
-      tex, {{0., tex->m_size.y - BORDER_BOTTOM - BORDER_VERBOTBOT - BORDER_VERBOTTOP},
-            {BORDER_LEFT, BORDER_VERBOTTOP}});
-  m_tex_lbe = ImgUtils::sliceTexture(
-      tex, {{0., tex->m_size.y - BORDER_BOTTOM - BORDER_VERBOTBOT},
-            {BORDER_LEFT, BORDER_VERBOTBOT}});
-
-  tex->destroyTexture();
-
-  g_pDecorationPositioner->repositionDeco(this);
+
+  return FPS;
 }
 
-void CImgBorder::updateRules() {
+void CImgBorder::onThemeReady(const SP<SBorderTheme> &theme) {
+  if (m_nextTheme && m_nextTheme == theme) {
+    m_theme = std::move(m_nextTheme);
+    m_nextTheme.reset();
+  } else if (m_theme != theme)
+    return;
+
+  m_layoutGeneration++;
+  damageEntire();
+}
+
+void CImgBorder::onFocusChanged() {
+  // Picked in makeInstance, the atlas already holds both looks
+  if (m_theme && (m_theme->states > 1 || m_theme->frames > 1))
+    damageEntire();
+}
+
+// Followed by the name of the theme
+constexpr std::string_view THEME_RULE = "plugin:imgborders:theme ";
+
+bool CImgBorder::readRules() {
   const auto PWINDOW = m_pWindow.lock();
+  if (!PWINDOW)
+    return false;
+
   auto rules = PWINDOW->m_matchedRules;
-  auto prevIsHidden = m_isHidden;
+  const auto PREVTHEME = std::move(m_themeName);
 
   m_isHidden = false;
+  m_themeName.clear();
   for (auto &r : rules) {
     if (r->m_rule == "plugin:imgborders:noimgborders")
       m_isHidden = true;
+    else if (r->m_rule.starts_with(THEME_RULE)) {
+      // The last one wins, like for Hyprland's own rules
+      m_themeName = r->m_rule.substr(THEME_RULE.size());
+      const auto END = m_themeName.find_last_not_of(' ');
+      m_themeName.erase(END == std::string::npos ? 0 : END + 1);
+    }
   }
 
+  return PREVTHEME != m_themeName;
+}
+
+void CImgBorder::updateRules() {
+  auto prevIsHidden = m_isHidden;
+
+  if (readRules())
+    applyConfig(g_pGlobalState->config);
+
   if (prevIsHidden != m_isHidden)
     g_pDecorationPositioner->repositionDeco(this);
 }
@@ -1,6 +1,9 @@
 #pragma once
 
+#include "BorderShader.hpp"
+#include "ConfigSnapshot.hpp"
 #include "globals.hpp"
+#include <chrono>
 #include <hyprland/src/desktop/DesktopTypes.hpp>
 #include <hyprland/src/desktop/WindowRule.hpp>
 #include <hyprland/src/render/Texture.hpp>
@@ -23,14 +26,32 @@ public:
 
   CBox getGlobalBoundingBox(PHLMONITOR pMonitor);
 
-  void drawPass(PHLMONITOR, float const &a);
+  // Border box around a window surface box, in the same coordinates
+  CBox getBorderBox(const CBox &surface);
+
+  // Where the window is drawn relative to where it is
+  static Vector2D getRenderOffset(PHLWINDOW pWindow);
+
+  // Lays the border out for this frame. False if there's nothing to draw.
+  // outSettled tells if the layout was the same last time.
+  bool makeInstance(PHLMONITOR, float a, SBorderInstance &outInstance,
+                    bool *outSettled = nullptr);
+
+  SBorderStyle getStyle();
+
+  float getScale() { return m_config->scale; }
 
   virtual eDecorationType getDecorationType();
 
   virtual void updateWindow(PHLWINDOW);
 
+  // Damages the border ring only, where it was last time and where it is now
   virtual void damageEntire();
 
+  // The area the border covers, in layout coordinates. Doesn't include the
+  // window inside it.
+  CRegion getRing();
+
   virtual eDecorationLayer getDecorationLayer();
 
   virtual uint64_t getDecorationFlags();
@@ -39,70 +60,91 @@ public:
 
   PHLWINDOW getWindow() { return m_pWindow.lock(); }
 
-  void updateConfig();
+  // Takes on config, or the named theme in it that the window rules pick,
+  // redoing only what changed since the one the border was on
+  void applyConfig(const SP<const SConfigSnapshot> &config);
+
+  // A theme got new pixels. Swaps it in if this border was waiting for it,
+  // redraws if it's the one on screen.
+  void onThemeReady(const SP<SBorderTheme> &theme);
+
+  // The window gained or lost focus. Redraws if that changes how the border
+  // looks, or whether it animates.
+  void onFocusChanged();
+
+  // Lets go of the theme if the border hasn't been drawn for idle, so its
+  // textures can be freed. It's picked up again on the next draw. Returns
+  // whether anything was released.
+  bool releaseIfIdle(std::chrono::steady_clock::time_point now,
+                     std::chrono::seconds idle);
 
   void updateRules();
 
-  WP<CImgBorder> m_self;
+  // Moves an animated border on to the frame due at now and damages its
+  // ring if it changed. Returns its frame rate, or 0 if it isn't animating,
+  // which it doesn't while unfocused or out of sight. Out of sight means on
+  // a hidden workspace, under a fullscreen window or not drawn for a while.
+  // Borders merely covered by other tiled or floating windows keep
+  // animating.
+  float animate(std::chrono::steady_clock::time_point now);
 
 private:
-  // Helper function for safe texture rendering with UV scaling
-  void safeRenderTexture(SP<CTexture> tex, const CBox& renderBox, float dimension, bool isWidth, const float& a);
+  friend class CBorderManager;
+  // Where CBorderManager keeps this border
+  size_t m_slot = 0;
+
   PHLWINDOWREF m_pWindow;
 
-  bool m_isEnabled;
-  bool m_isHidden;
-  int m_sizes[4];
-  int m_insets[4];
-  int m_hor_sizes[4];
-  int m_ver_sizes[4];
-  int m_top_placements[2];
-  int m_bottom_placements[2];
-  int m_left_placements[2];
-  int m_right_placements[2];
-
-  float m_scale;
-  bool m_shouldSmooth;
-  bool m_shouldBlurGlobal;
-  bool m_shouldBlur;
-
-  //corners
-  SP<CTexture> m_tex_tl;
-  SP<CTexture> m_tex_tr;
-  SP<CTexture> m_tex_br;
-  SP<CTexture> m_tex_bl;
-
-  //sides
-  SP<CTexture> m_tex_t;
-  SP<CTexture> m_tex_r;
-  SP<CTexture> m_tex_b;
-  SP<CTexture> m_tex_l;
-
-  //sides split up for even more custom borders
-  
-  SP<CTexture> m_tex_tle;
-  SP<CTexture> m_tex_tlc;
-  SP<CTexture> m_tex_tme;
-  SP<CTexture> m_tex_trc;
-  SP<CTexture> m_tex_tre;
-
-  SP<CTexture> m_tex_rte;
-  SP<CTexture> m_tex_rtc;
-  SP<CTexture> m_tex_rme;
-  SP<CTexture> m_tex_rbc;
-  SP<CTexture> m_tex_rbe;
-  
-  SP<CTexture> m_tex_ble;
-  SP<CTexture> m_tex_blc;
-  SP<CTexture> m_tex_bme;
-  SP<CTexture> m_tex_brc;
-  SP<CTexture> m_tex_bre;
-
-  SP<CTexture> m_tex_lte;
-  SP<CTexture> m_tex_ltc;
-  SP<CTexture> m_tex_lme;
-  SP<CTexture> m_tex_lbc;
-  SP<CTexture> m_tex_lbe;
-  
-  CBox m_bLastRelativeBox;
+  bool m_isEnabled = false;
+  bool m_isHidden = false;
+
+  // Shared with every other border on the same theme
+  SP<const SConfigSnapshot> m_config;
+  // Picked by a plugin:imgborders:theme rule, empty for the global config
+  std::string m_themeName;
+
+  // Shared with every other window using the same image and slices. The
+  // current one keeps being drawn while the next one loads.
+  SP<SBorderTheme> m_theme;
+  SP<SBorderTheme> m_nextTheme;
+
+  // What the config asks for, loaded on the first draw
+  SThemeKey m_themeKey;
+  std::chrono::steady_clock::time_point m_lastDrawn;
+
+  // Frame of an animated theme on screen, and when frame 0 would have been
+  // shown had it never paused
+  int m_frame = 0;
+  std::chrono::steady_clock::time_point m_frameStart;
+  bool m_animating = false;
+
+  // Last damaged by damageEntire
+  CRegion m_lastRing;
+
+  // Layout for the last window size, with the box relative to the window.
+  // Rebuilt when the size changes or the generation moves on, which it does
+  // on every config or theme change.
+  struct {
+    Vector2D windowSize;
+    uint64_t generation = 0;
+    bool valid = false;
+    bool drawable = false;
+    SBorderInstance instance;
+    // Translucent and opaque parts of the border, relative to the instance
+    // box
+    CRegion blur;
+    CRegion opaque;
+  } m_layout;
+  uint64_t m_layoutGeneration = 0;
+
+  void updateLayout(const Vector2D &windowSize);
+  void acquireTheme();
+
+  // Reads noimgborders and theme from the window's rules. Whether the theme
+  // changed.
+  bool readRules();
+
+  // See animate. Only an approximation of occlusion, checking every window
+  // above this one would cost more than the frames it saves.
+  bool shouldAnimate(std::chrono::steady_clock::time_point now);
 };
@@ -1,5 +1,7 @@
 #include "ImgBorderPassElement.hpp"
+#include "BorderBatch.hpp"
 #include "ImgBorder.hpp"
+#include <hyprland/src/helpers/Monitor.hpp>
 #include <hyprland/src/render/OpenGL.hpp>
 
 CImgBorderPassElement::CImgBorderPassElement(
@@ -8,15 +10,47 @@ CImgBorderPassElement::CImgBorderPassElement(
 }
 CImgBorderPassElement::~CImgBorderPassElement() {}
 
+bool CImgBorderPassElement::drawsBatch() {
+  return data.batch && data.batch->members.back() == data.deco;
+}
+
+bool CImgBorderPassElement::blurs() { return !data.blurBox.empty(); }
+
 void CImgBorderPassElement::draw(const CRegion &damage) {
-  data.deco->drawPass(g_pHyprOpenGL->m_renderData.pMonitor.lock(), data.a);
+  if (blurs()) {
+    // Bounding boxes are in layout units, drawing is in pixels
+    const auto PMONITOR = g_pHyprOpenGL->m_renderData.pMonitor.lock();
+    const float SCALE = PMONITOR ? PMONITOR->m_scale : 1.F;
+    g_pHyprOpenGL->renderRect(data.blurBox.copy().scale(SCALE),
+                              CHyprColor{0, 0, 0, 0}, {.blur = true});
+  }
+  else if (drawsBatch())
+    data.batch->draw();
 }
 
-bool CImgBorderPassElement::needsLiveBlur() { return data.deco->shouldBlur(); }
+bool CImgBorderPassElement::needsLiveBlur() { return blurs(); }
 
 bool CImgBorderPassElement::needsPrecomputeBlur() { return false; }
 
 std::optional<CBox> CImgBorderPassElement::boundingBox() {
-  return std::optional{data.deco->getGlobalBoundingBox(
-      g_pHyprOpenGL->m_renderData.pMonitor.lock())};
+  if (blurs())
+    return std::optional{data.blurBox};
+
+  // Elements of earlier members draw nothing
+  if (!drawsBatch())
+    return std::optional{CBox{}};
+
+  return std::optional{data.batch->area.getExtents()};
+}
+
+CRegion CImgBorderPassElement::opaqueRegion() {
+  if (blurs() || !drawsBatch())
+    return {};
+
+  // Scaled or moved by an animation, the boxes don't say where it lands
+  const auto &MODIF = g_pHyprOpenGL->m_renderData.renderModif;
+  if (MODIF.enabled && !MODIF.modifs.empty())
+    return {};
+
+  return data.batch->opaque;
 }
@@ -3,8 +3,9 @@
 #include <hyprland/src/render/Texture.hpp>
 #include <hyprland/src/render/pass/PassElement.hpp>
 
-// Class defined elsewhere
+// Classes defined elsewhere
 class CImgBorder;
+struct SBorderBatch;
 
 static const std::string PASS_NAME = "CImgBorderPassElement";
 
@@ -13,6 +14,13 @@ public:
   struct SData {
     CImgBorder *deco = nullptr;
     float a = 1.F;
+    // Batch the border was put in. Only the element of the batch's last
+    // member draws it.
+    SP<SBorderBatch> batch;
+    // Set on the elements that blur behind the border's translucent parts
+    // instead. They go before the border and cover nothing else, so live
+    // blur stays out of the window.
+    CBox blurBox;
   };
 
   CImgBorderPassElement(const SData &data_);
@@ -28,6 +36,11 @@ public:
 
   virtual std::optional<CBox> boundingBox();
 
+  virtual CRegion opaqueRegion();
+
 private:
+  bool drawsBatch();
+  bool blurs();
+
   SData data;
 };
@@ -0,0 +1,69 @@
+#include "ImgUtils.hpp"
+#include <GLES3/gl32.h>
+#include <cairo/cairo.h>
+#include <hyprland/src/render/OpenGL.hpp>
+#include <hyprland/src/render/Texture.hpp>
+
+// The parts of ImgUtils that make compositor textures. Everything else
+// builds without the compositor, see bench/.
+
+static SP<CTexture> invalidImageTexture = nullptr;
+static void initInvalidImageTexture() {
+  SP<CTexture> tex = makeShared<CTexture>();
+  tex->allocate();
+
+  const auto CAIROSURFACE =
+      cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 512, 512);
+  const auto CAIRO = cairo_create(CAIROSURFACE);
+
+  cairo_set_antialias(CAIRO, CAIRO_ANTIALIAS_NONE);
+  cairo_save(CAIRO);
+  cairo_set_source_rgba(CAIRO, 0, 0, 0, 1);
+  cairo_set_operator(CAIRO, CAIRO_OPERATOR_SOURCE);
+  cairo_paint(CAIRO);
+  cairo_set_source_rgba(CAIRO, 1, 0, 1, 1);
+  cairo_rectangle(CAIRO, 256, 0, 256, 256);
+  cairo_fill(CAIRO);
+  cairo_rectangle(CAIRO, 0, 256, 256, 256);
+  cairo_fill(CAIRO);
+  cairo_restore(CAIRO);
+
+  cairo_surface_flush(CAIROSURFACE);
+
+  tex->m_size = {512, 512};
+
+  // Copy the data to an OpenGL texture we have
+  const GLint glFormat = GL_RGBA;
+  const GLint glType = GL_UNSIGNED_BYTE;
+
+  const auto DATA = cairo_image_surface_get_data(CAIROSURFACE);
+  glBindTexture(GL_TEXTURE_2D, tex->m_texID);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_BLUE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+  glTexImage2D(GL_TEXTURE_2D, 0, glFormat, tex->m_size.x, tex->m_size.y, 0,
+               glFormat, glType, DATA);
+
+  cairo_surface_destroy(CAIROSURFACE);
+  cairo_destroy(CAIRO);
+
+  invalidImageTexture = tex;
+}
+
+SP<CTexture> ImgUtils::invalidTexture() {
+  if (!invalidImageTexture)
+    initInvalidImageTexture();
+  return invalidImageTexture;
+}
+
+SP<CTexture> ImgUtils::upload(const SImageData &image) {
+  auto tex = makeShared<CTexture>();
+  tex->allocate();
+  tex->m_size = image.size;
+
+  glBindTexture(GL_TEXTURE_2D, tex->m_texID);
+  texImage(image);
+
+  return tex;
+}
@@ -1,167 +1,432 @@
 #include "ImgUtils.hpp"
 #include <GLES3/gl32.h>
+#include <algorithm>
 #include <cairo/cairo.h>
+#include <cmath>
+#include <cstring>
 #include <filesystem>
-#include <format>
-#include <hyprland/src/debug/Log.hpp>
-#include <hyprland/src/render/OpenGL.hpp>
-#include <hyprland/src/render/Texture.hpp>
-
-static SP<CTexture> invalidImageTexture = nullptr;
-void initInvalidImageTexture() {
-  SP<CTexture> tex = makeShared<CTexture>();
-  tex->allocate();
-
-  const auto CAIROSURFACE =
-      cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 512, 512);
-  const auto CAIRO = cairo_create(CAIROSURFACE);
-
-  cairo_set_antialias(CAIRO, CAIRO_ANTIALIAS_NONE);
-  cairo_save(CAIRO);
-  cairo_set_source_rgba(CAIRO, 0, 0, 0, 1);
-  cairo_set_operator(CAIRO, CAIRO_OPERATOR_SOURCE);
-  cairo_paint(CAIRO);
-  cairo_set_source_rgba(CAIRO, 1, 0, 1, 1);
-  cairo_rectangle(CAIRO, 256, 0, 256, 256);
-  cairo_fill(CAIRO);
-  cairo_rectangle(CAIRO, 0, 256, 256, 256);
-  cairo_fill(CAIRO);
-  cairo_restore(CAIRO);
+#include <fstream>
+#include <limits>
+#include <numbers>
 
-  cairo_surface_flush(CAIROSURFACE);
+bool ImgUtils::readFile(const std::string &fullPath,
+                        std::vector<uint8_t> &outBytes, std::string &outError) {
+  if (!std::filesystem::exists(fullPath)) {
+    outError = "image doesn't exist. typo?";
+    return false;
+  }
 
-  tex->m_size = {512, 512};
+  std::ifstream file(fullPath, std::ios::binary | std::ios::ate);
+  if (!file.good()) {
+    outError = "inaccessible";
+    return false;
+  }
 
-  // Copy the data to an OpenGL texture we have
-  const GLint glFormat = GL_RGBA;
-  const GLint glType = GL_UNSIGNED_BYTE;
+  outBytes.resize(file.tellg());
+  file.seekg(0);
+  file.read((char *)outBytes.data(), outBytes.size());
+  if (!file.good()) {
+    outError = "read failed";
+    return false;
+  }
 
-  const auto DATA = cairo_image_surface_get_data(CAIROSURFACE);
-  glBindTexture(GL_TEXTURE_2D, tex->m_texID);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_BLUE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
-  glTexImage2D(GL_TEXTURE_2D, 0, glFormat, tex->m_size.x, tex->m_size.y, 0,
-               glFormat, glType, DATA);
+  return true;
+}
 
-  cairo_surface_destroy(CAIROSURFACE);
-  cairo_destroy(CAIRO);
+uint64_t ImgUtils::contentHash(std::span<const uint8_t> bytes) {
+  // FNV-1a
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (const auto B : bytes) {
+    h ^= B;
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
 
-  invalidImageTexture = tex;
+static float lanczos3(float x) {
+  if (x == 0.F)
+    return 1.F;
+  if (std::abs(x) >= 3.F)
+    return 0.F;
+  const float PX = std::numbers::pi_v<float> * x;
+  return 3.F * std::sin(PX) * std::sin(PX / 3.F) / (PX * PX);
 }
 
-SP<CTexture> ImgUtils::load(const std::string &fullPath) {
-  if (!std::filesystem::exists(fullPath)) {
-    Debug::log(ERR, "ImgUtils failed to load {} (image doesn't exist. typo?)",
-               fullPath);
-    if (!invalidImageTexture) {
-      initInvalidImageTexture();
+// Which source pixels go into each destination pixel and how much. Every
+// destination pixel gets the same number of taps, so the loops using them
+// have a fixed trip count and vectorize.
+struct SFilter {
+  int taps = 0;
+  std::vector<int> index;
+  std::vector<float> weight;
+};
+
+static SFilter makeFilter(int srcLen, int dstLen, bool wrap) {
+  const float RATIO = (float)srcLen / (float)dstLen;
+  // Shrinking widens the kernel, so every source pixel counts
+  const float STRETCH = std::max(1.F, RATIO);
+  const int RADIUS = (int)std::ceil(3.F * STRETCH);
+
+  SFilter filter;
+  filter.taps = RADIUS * 2 + 1;
+  filter.index.resize((size_t)dstLen * filter.taps);
+  filter.weight.resize((size_t)dstLen * filter.taps);
+
+  for (int i = 0; i < dstLen; i++) {
+    const float CENTER = ((float)i + 0.5F) * RATIO - 0.5F;
+    const int FIRST = (int)std::floor(CENTER) - RADIUS;
+    auto *index = filter.index.data() + (size_t)i * filter.taps;
+    auto *weight = filter.weight.data() + (size_t)i * filter.taps;
+
+    float sum = 0.F;
+    for (int k = 0; k < filter.taps; k++) {
+      const int AT = FIRST + k;
+      index[k] = wrap ? ((AT % srcLen) + srcLen) % srcLen
+                      : std::clamp(AT, 0, srcLen - 1);
+      weight[k] = lanczos3(((float)AT - CENTER) / STRETCH);
+      sum += weight[k];
     }
-    return invalidImageTexture;
+    for (int k = 0; k < filter.taps; k++)
+      weight[k] /= sum;
   }
 
-  const auto CAIROSURFACE =
-      cairo_image_surface_create_from_png(fullPath.c_str());
+  return filter;
+}
+
+void ImgUtils::resample(const uint8_t *src, size_t srcStride, int w, int h,
+                        uint8_t *dst, size_t dstStride, int dstW, int dstH,
+                        bool wrapX, bool wrapY, bool premultiplied) {
+  if (w <= 0 || h <= 0 || dstW <= 0 || dstH <= 0)
+    return;
+
+  const auto FX = makeFilter(w, dstW, wrapX);
+  const auto FY = makeFilter(h, dstH, wrapY);
+  const size_t ROW = (size_t)dstW * 4;
 
-  if (!CAIROSURFACE) {
-    Debug::log(ERR,
-               "ImgUtils failed to load {} (corrupt / inaccessible / not png)",
-               fullPath);
-    if (!invalidImageTexture) {
-      initInvalidImageTexture();
+  // Horizontally into floats first, then down the columns of that
+  std::vector<float> tmp((size_t)h * ROW);
+  for (int y = 0; y < h; y++) {
+    const auto *in = src + (size_t)y * srcStride;
+    auto *out = tmp.data() + (size_t)y * ROW;
+    for (int x = 0; x < dstW; x++) {
+      const auto *index = FX.index.data() + (size_t)x * FX.taps;
+      const auto *weight = FX.weight.data() + (size_t)x * FX.taps;
+      float acc[4] = {};
+      for (int k = 0; k < FX.taps; k++) {
+        const auto *px = in + (size_t)index[k] * 4;
+        for (int c = 0; c < 4; c++)
+          acc[c] += weight[k] * (float)px[c];
+      }
+      for (int c = 0; c < 4; c++)
+        out[(size_t)x * 4 + c] = acc[c];
     }
-    return invalidImageTexture;
+  }
+
+  std::vector<float> acc(ROW);
+  for (int y = 0; y < dstH; y++) {
+    const auto *index = FY.index.data() + (size_t)y * FY.taps;
+    const auto *weight = FY.weight.data() + (size_t)y * FY.taps;
+    std::ranges::fill(acc, 0.F);
+    for (int k = 0; k < FY.taps; k++) {
+      const auto *in = tmp.data() + (size_t)index[k] * ROW;
+      const float W = weight[k];
+      for (size_t i = 0; i < ROW; i++)
+        acc[i] += W * in[i];
+    }
+
+    auto *out = dst + (size_t)y * dstStride;
+    for (size_t i = 0; i < ROW; i++)
+      out[i] = (uint8_t)std::clamp(std::lround(acc[i]), 0L, 255L);
+
+    // Alpha is the fourth byte in both byte orders
+    if (premultiplied) {
+      for (int x = 0; x < dstW; x++) {
+        auto *px = out + (size_t)x * 4;
+        for (int c = 0; c < 3; c++)
+          px[c] = std::min(px[c], px[3]);
+      }
+    }
+  }
+}
+
+uint16_t ImgUtils::toHalf(float f) {
+  uint32_t x;
+  std::memcpy(&x, &f, sizeof(x));
+
+  const uint16_t SIGN = (x >> 16) & 0x8000;
+  const uint32_t BIASED = (x >> 23) & 0xff;
+  const int EXP = (int)BIASED - 127 + 15;
+  uint32_t mant = x & 0x7fffff;
+
+  if (BIASED == 0xff)
+    return SIGN | 0x7c00 | (mant ? 0x200 : 0);
+  if (EXP >= 31)
+    return SIGN | 0x7c00;
+
+  // Round to nearest, ties to even. A carry out of the mantissa correctly
+  // bumps the exponent.
+  const auto ROUND = [](uint32_t value, uint32_t rest, int bits) {
+    const uint32_t MID = 1u << (bits - 1);
+    if (rest > MID || (rest == MID && (value & 1)))
+      value++;
+    return value;
+  };
+
+  if (EXP <= 0) {
+    if (EXP < -10)
+      return SIGN;
+    mant |= 0x800000;
+    const int SHIFT = 14 - EXP;
+    return SIGN | (uint16_t)ROUND(mant >> SHIFT,
+                                  mant & ((1u << SHIFT) - 1), SHIFT);
+  }
+
+  return SIGN |
+         (uint16_t)ROUND(((uint32_t)EXP << 10) | (mant >> 13), mant & 0x1fff,
+                         13);
+}
+
+float ImgUtils::fromHalf(uint16_t h) {
+  const uint32_t EXP = (h >> 10) & 0x1f;
+  const uint32_t MANT = h & 0x3ff;
+
+  float f;
+  if (EXP == 0)
+    f = std::ldexp((float)MANT, -24);
+  else if (EXP == 31)
+    f = MANT ? std::numeric_limits<float>::quiet_NaN()
+             : std::numeric_limits<float>::infinity();
+  else
+    f = std::ldexp((float)(MANT | 0x400), (int)EXP - 25);
+
+  return (h & 0x8000) ? -f : f;
+}
+
+bool ImgUtils::decode(std::span<const uint8_t> png, SImageData &outImage,
+                      std::string &outError) {
+  auto stream = png;
+  const auto CAIROSURFACE = cairo_image_surface_create_from_png_stream(
+      [](void *closure, unsigned char *data, unsigned int length) {
+        auto &rest = *static_cast<std::span<const uint8_t> *>(closure);
+        if (rest.size() < length)
+          return CAIRO_STATUS_READ_ERROR;
+        std::memcpy(data, rest.data(), length);
+        rest = rest.subspan(length);
+        return CAIRO_STATUS_SUCCESS;
+      },
+      &stream);
+
+  if (cairo_surface_status(CAIROSURFACE) != CAIRO_STATUS_SUCCESS) {
+    cairo_surface_destroy(CAIROSURFACE);
+    outError = "corrupt / not png";
+    return false;
   }
 
   const auto CAIROFORMAT = cairo_image_surface_get_format(CAIROSURFACE);
-  auto tex = makeShared<CTexture>();
-
-  // Debug: Log the Cairo format to help diagnose transparency issues
-  Debug::log(LOG, "ImgUtils loading {}, Cairo format: {}", fullPath, (int)CAIROFORMAT);
-  
-  tex->allocate();
-  tex->m_size = {cairo_image_surface_get_width(CAIROSURFACE),
-                 cairo_image_surface_get_height(CAIROSURFACE)};
-
-  // Improved format handling for transparency
-  GLint glIFormat, glFormat;
-  const GLint glType = CAIROFORMAT == CAIRO_FORMAT_RGB96F ? GL_FLOAT : GL_UNSIGNED_BYTE;
-  
+  const auto W = cairo_image_surface_get_width(CAIROSURFACE);
+  const auto H = cairo_image_surface_get_height(CAIROSURFACE);
+
+  // Nothing of an image decoded into it before survives, swizzle, mip
+  // levels and mappings included
+  outImage = {};
+  outImage.size = {W, H};
+
+  size_t bytesPerPixel = 4;
   switch (CAIROFORMAT) {
-    case CAIRO_FORMAT_ARGB32:
-    case CAIRO_FORMAT_A8:
-      glIFormat = GL_RGBA;
-      glFormat = GL_RGBA;
-      Debug::log(LOG, "ImgUtils: Loading with alpha channel support");
-      break;
-    case CAIRO_FORMAT_RGB24:
-      glIFormat = GL_RGB;
-      glFormat = GL_RGB;
-      Debug::log(WARN, "ImgUtils: Loading RGB image without alpha channel - transparency won't work");
-      break;
-    case CAIRO_FORMAT_RGB96F:
-      glIFormat = GL_RGB32F;
-      glFormat = GL_RGB;
-      break;
-    default:
-      Debug::log(WARN, "ImgUtils: Unknown Cairo format {}, defaulting to RGBA", (int)CAIROFORMAT);
-      glIFormat = GL_RGBA;
-      glFormat = GL_RGBA;
-      break;
+  case CAIRO_FORMAT_ARGB32:
+    outImage.internalFormat = GL_RGBA;
+    outImage.format = GL_RGBA;
+    outImage.swapRB = true;
+    break;
+  case CAIRO_FORMAT_RGB24:
+    // Still four bytes per pixel, the unused one must not be read as alpha
+    outImage.internalFormat = GL_RGBA;
+    outImage.format = GL_RGBA;
+    outImage.swapRB = true;
+    outImage.noAlpha = true;
+    break;
+  case CAIRO_FORMAT_RGB96F:
+  case CAIRO_FORMAT_RGBA128F:
+    // 16-bit PNGs. Half floats keep their precision at half the size, with
+    // alpha always there so everything after works on RGBA.
+    outImage.internalFormat = GL_RGBA16F;
+    outImage.format = GL_RGBA;
+    outImage.type = GL_HALF_FLOAT;
+    bytesPerPixel = 8;
+    break;
+  default:
+    outImage.internalFormat = GL_RGBA;
+    outImage.format = GL_RGBA;
+    break;
   }
 
+  // Rows are copied tightly packed, cairo may pad them
+  cairo_surface_flush(CAIROSURFACE);
   const auto DATA = cairo_image_surface_get_data(CAIROSURFACE);
-  glBindTexture(GL_TEXTURE_2D, tex->m_texID);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  const auto STRIDE = (size_t)cairo_image_surface_get_stride(CAIROSURFACE);
+  const auto ROWBYTES = (size_t)W * bytesPerPixel;
 
-  // Only apply color swizzling for formats that need it
-  if (CAIROFORMAT == CAIRO_FORMAT_ARGB32 || CAIROFORMAT == CAIRO_FORMAT_RGB24) {
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_BLUE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+  outImage.pixels.resize(ROWBYTES * H);
+  if (outImage.type == GL_HALF_FLOAT) {
+    const int CHANNELS = CAIROFORMAT == CAIRO_FORMAT_RGBA128F ? 4 : 3;
+    for (int y = 0; y < H; y++) {
+      const auto *in = (const float *)(DATA + y * STRIDE);
+      auto *out = (uint16_t *)(outImage.pixels.data() + y * ROWBYTES);
+      for (int x = 0; x < W; x++) {
+        for (int c = 0; c < CHANNELS; c++)
+          out[x * 4 + c] = toHalf(in[x * CHANNELS + c]);
+        if (CHANNELS == 3)
+          out[x * 4 + 3] = toHalf(1.F);
+      }
+    }
+  } else {
+    for (int y = 0; y < H; y++)
+      std::memcpy(outImage.pixels.data() + y * ROWBYTES, DATA + y * STRIDE,
+                  ROWBYTES);
   }
 
-  glTexImage2D(GL_TEXTURE_2D, 0, glIFormat, tex->m_size.x, tex->m_size.y, 0,
-               glFormat, glType, DATA);
-
   cairo_surface_destroy(CAIROSURFACE);
 
-  return tex;
+  return true;
+}
+
+// Whether an 8-bit value survives being stored with fewer bits and read
+// back as a normalized float, rounded to 8 bits again
+static bool fitsBits(uint8_t v, int bits) {
+  const int MAX = (1 << bits) - 1;
+  const int Q = (v * MAX + 127) / 255;
+  return (Q * 255 + MAX / 2) / MAX == v;
 }
 
-SP<CTexture> ImgUtils::sliceTexture(SP<CTexture> src, const CBox &box) {
-  if (box.width == 0 || box.height == 0) {
-    return nullptr;
+void ImgUtils::compact(SImageData &image, bool allow16) {
+  if (image.type != GL_UNSIGNED_BYTE || image.format != GL_RGBA ||
+      image.swizzle)
+    return;
+
+  const size_t COUNT = (size_t)image.size.x * (size_t)image.size.y;
+  const int RI = image.swapRB ? 2 : 0;
+  const int BI = image.swapRB ? 0 : 2;
+  const auto *px = image.pixels.data();
+
+  bool grey = true, opaque = true, fits565 = true, fits4444 = true;
+  for (size_t i = 0; i < COUNT && (grey || fits565 || fits4444); i++) {
+    const auto *p = px + i * 4;
+    const uint8_t A = image.noAlpha ? 255 : p[3];
+    grey = grey && p[0] == p[1] && p[1] == p[2];
+    opaque = opaque && A == 255;
+    fits565 = fits565 && fitsBits(p[RI], 5) && fitsBits(p[1], 6) &&
+              fitsBits(p[BI], 5);
+    fits4444 = fits4444 && p[0] % 17 == 0 && p[1] % 17 == 0 &&
+               p[2] % 17 == 0 && A % 17 == 0;
+  }
+
+  std::vector<uint8_t> packed;
+  if (grey) {
+    const int CHANNELS = opaque ? 1 : 2;
+    packed.resize(COUNT * CHANNELS);
+    for (size_t i = 0; i < COUNT; i++) {
+      packed[i * CHANNELS] = px[i * 4 + 1];
+      if (!opaque)
+        packed[i * CHANNELS + 1] = px[i * 4 + 3];
+    }
+    image.internalFormat = opaque ? GL_R8 : GL_RG8;
+    image.format = opaque ? GL_RED : GL_RG;
+    image.swizzle = {GL_RED, GL_RED, GL_RED, opaque ? GL_ONE : GL_GREEN};
+  } else if (allow16 && ((opaque && fits565) || fits4444)) {
+    const bool USE565 = opaque && fits565;
+    packed.resize(COUNT * 2);
+    for (size_t i = 0; i < COUNT; i++) {
+      const auto *p = px + i * 4;
+      const uint8_t A = image.noAlpha ? 255 : p[3];
+      const uint16_t V =
+          USE565 ? (uint16_t)(((p[RI] * 31 + 127) / 255) << 11 |
+                              ((p[1] * 63 + 127) / 255) << 5 |
+                              ((p[BI] * 31 + 127) / 255))
+                 : (uint16_t)((p[RI] / 17) << 12 | (p[1] / 17) << 8 |
+                              (p[BI] / 17) << 4 | (A / 17));
+      std::memcpy(packed.data() + i * 2, &V, sizeof(V));
+    }
+    image.internalFormat = USE565 ? GL_RGB565 : GL_RGBA4;
+    image.format = USE565 ? GL_RGB : GL_RGBA;
+    image.type = USE565 ? GL_UNSIGNED_SHORT_5_6_5 : GL_UNSIGNED_SHORT_4_4_4_4;
+    image.swizzle = {GL_RED, GL_GREEN, GL_BLUE, USE565 ? GL_ONE : GL_ALPHA};
+  } else
+    return;
+
+  image.pixels = std::move(packed);
+}
+
+size_t ImgUtils::texelBytes(const SImageData &image) {
+  size_t texel = 4;
+  switch (image.internalFormat) {
+  case GL_R8:
+    texel = 1;
+    break;
+  case GL_RG8:
+  case GL_RGB565:
+  case GL_RGBA4:
+    texel = 2;
+    break;
+  case GL_RGBA16F:
+    texel = 8;
+    break;
+  default:
+    break;
   }
+  return texel;
+}
 
-  // Initialize the dst texture
-  // ------------
+size_t ImgUtils::textureBytes(const SImageData &image) {
+  const size_t BASE =
+      (size_t)image.size.x * (size_t)image.size.y * texelBytes(image);
+  // A full chain adds a third
+  return image.mipLevels > 0 ? BASE + BASE / 3 : BASE;
+}
 
-  SP<CTexture> tex = makeShared<CTexture>();
-  tex->allocate();
-  tex->m_size = box.size();
+const char *ImgUtils::formatName(const SImageData &image) {
+  switch (image.internalFormat) {
+  case GL_R8:
+    return "R8";
+  case GL_RG8:
+    return "RG8";
+  case GL_RGB565:
+    return "RGB565";
+  case GL_RGBA4:
+    return "RGBA4";
+  case GL_RGBA16F:
+    return "RGBA16F";
+  default:
+    return "RGBA8";
+  }
+}
 
-  const GLint glIFormat = GL_RGBA;
-  const GLint glFormat = GL_RGBA;
-  const GLint glType = GL_UNSIGNED_BYTE;
-  const int DATA_SIZE = box.width * box.height * 4;
-  const auto DATA = new unsigned char[DATA_SIZE]{0};
-  glBindTexture(GL_TEXTURE_2D, tex->m_texID);
+void ImgUtils::texImage(const SImageData &image) {
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_BLUE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
-  glTexImage2D(GL_TEXTURE_2D, 0, glIFormat, tex->m_size.x, tex->m_size.y, 0,
-               glFormat, glType, DATA);
-  delete[] DATA;
 
-  // Copy the region from src to dst
-  // ------------
+  if (image.swizzle) {
+    const std::array<GLenum, 4> PARAMS = {
+        GL_TEXTURE_SWIZZLE_R, GL_TEXTURE_SWIZZLE_G, GL_TEXTURE_SWIZZLE_B,
+        GL_TEXTURE_SWIZZLE_A};
+    for (size_t i = 0; i < 4; i++)
+      glTexParameteri(GL_TEXTURE_2D, PARAMS[i], (*image.swizzle)[i]);
+  } else {
+    if (image.swapRB) {
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_BLUE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+    }
+    if (image.noAlpha)
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, GL_ONE);
+  }
 
-  glCopyImageSubData(src->m_texID, GL_TEXTURE_2D, 0, box.x, box.y, 0,
-                     tex->m_texID, GL_TEXTURE_2D, 0, 0, 0, 0, tex->m_size.x,
-                     tex->m_size.y, 1);
+  // Rows of the smaller formats aren't always a multiple of 4 bytes
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D(GL_TEXTURE_2D, 0, image.internalFormat, image.size.x,
+               image.size.y, 0, image.format, image.type, image.data());
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
-  return tex;
+  if (image.mipLevels > 0) {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.mipLevels);
+    glGenerateMipmap(GL_TEXTURE_2D);
+  }
 }
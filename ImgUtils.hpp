@@ -1,9 +1,89 @@
 #pragma once
 
+#include <GLES3/gl32.h>
+#include <array>
+#include <cstdint>
 #include <hyprland/src/render/Texture.hpp>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+// A decoded image still in CPU memory, laid out the way glTexImage2D wants it
+struct SImageData {
+  Vector2D size;
+  GLint internalFormat = GL_RGBA;
+  GLenum format = GL_RGBA;
+  GLenum type = GL_UNSIGNED_BYTE;
+
+  // Cairo keeps pixels as native endian ARGB, so red and blue come out
+  // swapped and RGB24 has a padding byte where alpha would be.
+  bool swapRB = false;
+  bool noAlpha = false;
+
+  // Mip levels to generate on upload
+  int mipLevels = 0;
+
+  // Set once compact() repacked the pixels, where the shader's RGBA come from
+  std::optional<std::array<GLint, 4>> swizzle;
+
+  std::vector<uint8_t> pixels;
+
+  // Set instead of pixels when they're read straight from a mapped file,
+  // which stays mapped as long as this does
+  std::shared_ptr<const void> mapping;
+  const uint8_t *mappedPixels = nullptr;
+
+  const uint8_t *data() const {
+    return mapping ? mappedPixels : pixels.data();
+  }
+};
 
 namespace ImgUtils {
-SP<CTexture> load(const std::string &filename);
+// These don't touch GL or the compositor, so they can run on any thread. On
+// failure outError says why.
+bool readFile(const std::string &path, std::vector<uint8_t> &outBytes,
+              std::string &outError);
+bool decode(std::span<const uint8_t> png, SImageData &outImage,
+            std::string &outError);
+
+// IEEE half floats, as stored in GL_HALF_FLOAT images
+uint16_t toHalf(float f);
+float fromHalf(uint16_t h);
+
+// Cheap fingerprint of a file's contents, to tell real changes from touches
+uint64_t contentHash(std::span<const uint8_t> bytes);
+
+// Lanczos-3 resize of a w x h block of 8-bit RGBA pixels into dstW x dstH.
+// Strides are in bytes. Axes that wrap are filtered as if the block repeated,
+// the others as if its edge pixels went on forever. With premultiplied set
+// colour is kept at or below alpha despite the kernel's ringing.
+void resample(const uint8_t *src, size_t srcStride, int w, int h,
+              uint8_t *dst, size_t dstStride, int dstW, int dstH, bool wrapX,
+              bool wrapY, bool premultiplied);
+
+// Repacks 8-bit RGBA pixels into the smallest format that samples to the
+// same values: R8 for opaque grey, RG8 for grey with alpha and, with
+// allow16, RGB565 or RGBA4 where every channel survives the round trip.
+// Left alone otherwise.
+void compact(SImageData &image, bool allow16);
+
+// Size of one pixel in memory and on the GPU, which are the same for every
+// format used
+size_t texelBytes(const SImageData &image);
+
+// What the image takes up as a texture, and what its format is called
+size_t textureBytes(const SImageData &image);
+const char *formatName(const SImageData &image);
+
+// Fills the bound GL_TEXTURE_2D with image, its swizzle and mips. Needs a
+// context current, but not the compositor's.
+void texImage(const SImageData &image);
+
+// Needs the render context current
+SP<CTexture> upload(const SImageData &image);
 
-SP<CTexture> sliceTexture(SP<CTexture> tex, const CBox &box);
+// Checkerboard shown in place of images that failed to load
+SP<CTexture> invalidTexture();
 } // namespace ImgUtils
@@ -0,0 +1,331 @@
+#include "Theme.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <tuple>
+
+size_t SThemeKeyHash::operator()(const SThemeKey &key) const {
+  size_t h = std::hash<std::string>{}(key.path);
+  const auto mix = [&h](int64_t v) {
+    h ^= std::hash<int64_t>{}(v) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+  };
+  mix(key.mtime);
+  mix(key.mipmap);
+  mix(key.compact16);
+  mix(key.frames);
+  mix(key.states);
+  for (int i = 0; i < 4; i++) {
+    mix(key.sizes[i]);
+    mix(key.horSizes[i]);
+    mix(key.verSizes[i]);
+  }
+  return h;
+}
+
+std::array<CBox, SECTION_COUNT>
+ThemeUtils::layoutSections(const SThemeKey &key, const Vector2D &imageSize) {
+  std::array<CBox, SECTION_COUNT> sec;
+
+  const auto BORDER_LEFT = (float)key.sizes[0];
+  const auto BORDER_RIGHT = (float)key.sizes[1];
+  const auto BORDER_TOP = (float)key.sizes[2];
+  const auto BORDER_BOTTOM = (float)key.sizes[3];
+
+  const auto BORDER_VERTOPTOP = (float)key.verSizes[0];
+  const auto BORDER_VERTOPBOT = (float)key.verSizes[1];
+  const auto BORDER_VERBOTTOP = (float)key.verSizes[2];
+  const auto BORDER_VERBOTBOT = (float)key.verSizes[3];
+
+  const auto BORDER_HORLEFTLEFT = (float)key.horSizes[0];
+  const auto BORDER_HORLEFTRIGHT = (float)key.horSizes[1];
+  const auto BORDER_HORRIGHTLEFT = (float)key.horSizes[2];
+  const auto BORDER_HORRIGHTRIGHT = (float)key.horSizes[3];
+
+  const auto W = (float)imageSize.x;
+  const auto H = (float)imageSize.y;
+
+  sec[SECTION_TL] = {{0., 0.}, {BORDER_LEFT, BORDER_TOP}};
+  sec[SECTION_TR] = {{W - BORDER_RIGHT, 0.}, {BORDER_RIGHT, BORDER_TOP}};
+  sec[SECTION_BR] = {{W - BORDER_RIGHT, H - BORDER_BOTTOM},
+                     {BORDER_RIGHT, BORDER_BOTTOM}};
+  sec[SECTION_BL] = {{0., H - BORDER_BOTTOM}, {BORDER_LEFT, BORDER_BOTTOM}};
+
+  // 7x7 FUNCTIONALITY
+  // Middle pieces take whatever the other pieces leave of each side
+  const auto HOR_MID = W - BORDER_RIGHT - BORDER_HORRIGHTRIGHT -
+                       BORDER_HORRIGHTLEFT - BORDER_LEFT - BORDER_HORLEFTLEFT -
+                       BORDER_HORLEFTRIGHT;
+  const auto VER_MID = H - BORDER_BOTTOM - BORDER_VERBOTBOT -
+                       BORDER_VERBOTTOP - BORDER_TOP - BORDER_VERTOPTOP -
+                       BORDER_VERTOPBOT;
+
+  // TOP and BOTTOM share their horizontal layout
+  for (const auto &[FIRST, Y, HEIGHT] :
+       {std::tuple{SECTION_TLE, 0.F, BORDER_TOP},
+        std::tuple{SECTION_BLE, H - BORDER_BOTTOM, BORDER_BOTTOM}}) {
+    sec[FIRST + 0] = {{BORDER_LEFT, Y}, {BORDER_HORLEFTLEFT, HEIGHT}};
+    sec[FIRST + 1] = {{BORDER_LEFT + BORDER_HORLEFTLEFT, Y},
+                      {BORDER_HORLEFTRIGHT, HEIGHT}};
+    sec[FIRST + 2] = {
+        {BORDER_LEFT + BORDER_HORLEFTLEFT + BORDER_HORLEFTRIGHT, Y},
+        {HOR_MID, HEIGHT}};
+    sec[FIRST + 3] = {
+        {W - BORDER_RIGHT - BORDER_HORRIGHTRIGHT - BORDER_HORRIGHTLEFT, Y},
+        {BORDER_HORRIGHTLEFT, HEIGHT}};
+    sec[FIRST + 4] = {{W - BORDER_RIGHT - BORDER_HORRIGHTRIGHT, Y},
+                      {BORDER_HORRIGHTRIGHT, HEIGHT}};
+  }
+
+  // RIGHT and LEFT share their vertical layout
+  for (const auto &[FIRST, X, WIDTH] :
+       {std::tuple{SECTION_RTE, W - BORDER_RIGHT, BORDER_RIGHT},
+        std::tuple{SECTION_LTE, 0.F, BORDER_LEFT}}) {
+    sec[FIRST + 0] = {{X, BORDER_TOP}, {WIDTH, BORDER_VERTOPTOP}};
+    sec[FIRST + 1] = {{X, BORDER_TOP + BORDER_VERTOPTOP},
+                      {WIDTH, BORDER_VERTOPBOT}};
+    sec[FIRST + 2] = {{X, BORDER_TOP + BORDER_VERTOPTOP + BORDER_VERTOPBOT},
+                      {WIDTH, VER_MID}};
+    sec[FIRST + 3] = {
+        {X, H - BORDER_BOTTOM - BORDER_VERBOTBOT - BORDER_VERBOTTOP},
+        {WIDTH, BORDER_VERBOTTOP}};
+    sec[FIRST + 4] = {{X, H - BORDER_BOTTOM - BORDER_VERBOTBOT},
+                      {WIDTH, BORDER_VERBOTBOT}};
+  }
+
+  return sec;
+}
+
+std::array<SSectionCoverage, SECTION_COUNT>
+ThemeUtils::measureCoverage(const SImageData &image,
+                            const std::array<CBox, SECTION_COUNT> &sections) {
+  std::array<SSectionCoverage, SECTION_COUNT> coverage;
+
+  // 8-bit cairo formats keep alpha in the top byte of each native endian
+  // pixel, half float ones in the fourth channel
+  const bool HALF = image.type == GL_HALF_FLOAT && image.format == GL_RGBA;
+  const bool HASALPHA =
+      HALF || (!image.noAlpha && image.type == GL_UNSIGNED_BYTE &&
+               image.format == GL_RGBA);
+  const auto BPP = ImgUtils::texelBytes(image);
+  const auto W = (int)image.size.x;
+  const auto H = (int)image.size.y;
+
+  for (size_t i = 0; i < SECTION_COUNT; i++) {
+    const auto &SEC = sections[i];
+    const int X0 = std::clamp((int)SEC.x, 0, W);
+    const int Y0 = std::clamp((int)SEC.y, 0, H);
+    const int X1 = std::clamp((int)(SEC.x + SEC.width), 0, W);
+    const int Y1 = std::clamp((int)(SEC.y + SEC.height), 0, H);
+
+    auto &cov = coverage[i];
+    if (!HASALPHA) {
+      cov.opaque = std::max(0, X1 - X0) * std::max(0, Y1 - Y0);
+      continue;
+    }
+
+    for (int y = Y0; y < Y1; y++) {
+      const auto *ROW = image.pixels.data() + (size_t)y * W * BPP;
+      for (int x = X0; x < X1; x++) {
+        float a;
+        if (HALF) {
+          uint16_t h;
+          std::memcpy(&h, ROW + (size_t)x * BPP + 6, sizeof(h));
+          a = ImgUtils::fromHalf(h) * 255.F;
+        } else {
+          uint32_t px;
+          std::memcpy(&px, ROW + (size_t)x * BPP, sizeof(px));
+          a = (float)(px >> 24);
+        }
+        // Same threshold as the shader's discard
+        if (a < 3.F)
+          cov.transparent++;
+        else if (a < 255.F)
+          cov.translucent++;
+        else
+          cov.opaque++;
+      }
+    }
+  }
+
+  return coverage;
+}
+
+bool ThemeUtils::isTiled(size_t section, bool horizontal) {
+  if (section < SECTION_TLE)
+    return false;
+
+  // First, middle and last piece of each edge, the custom ones stretch
+  const auto EDGE = (section - SECTION_TLE) / 5;
+  const auto PIECE = (section - SECTION_TLE) % 5;
+  const bool EDGEHORIZONTAL = EDGE == 0 || EDGE == 2;
+  return PIECE % 2 == 0 && EDGEHORIZONTAL == horizontal;
+}
+
+bool ThemeUtils::padSections(const SImageData &image,
+                             const std::array<CBox, SECTION_COUNT> &sections,
+                             int levels, SImageData &outImage,
+                             std::array<CBox, SECTION_COUNT> &outSections) {
+  // 32-bit floats aren't filterable in GLES, so they can't have mips
+  if ((image.type != GL_UNSIGNED_BYTE && image.type != GL_HALF_FLOAT) ||
+      image.format != GL_RGBA)
+    return false;
+
+  const auto BPP = ImgUtils::texelBytes(image);
+
+  const int ALIGN = 1 << levels;
+  const int GUTTER = ALIGN;
+  const int MAXROW = std::max(2048, (int)image.size.x);
+  const auto SRCW = (int)image.size.x;
+  const auto ALIGNUP = [ALIGN](int v) { return (v + ALIGN - 1) / ALIGN * ALIGN; };
+
+  // Shelf packing, in section order
+  std::array<std::pair<int, int>, SECTION_COUNT> cells;
+  int x = 0, y = 0, rowH = 0, width = 0;
+  for (size_t i = 0; i < SECTION_COUNT; i++) {
+    const auto CELLW = ALIGNUP((int)sections[i].width + GUTTER * 2);
+    const auto CELLH = ALIGNUP((int)sections[i].height + GUTTER * 2);
+    if (x > 0 && x + CELLW > MAXROW) {
+      y += rowH;
+      x = 0;
+      rowH = 0;
+    }
+    cells[i] = {x, y};
+    x += CELLW;
+    rowH = std::max(rowH, CELLH);
+    width = std::max(width, x);
+  }
+  const int HEIGHT = y + rowH;
+
+  outImage = image;
+  outImage.size = {(double)width, (double)HEIGHT};
+  outImage.pixels.assign((size_t)width * HEIGHT * BPP, 0);
+  outImage.mipLevels = levels;
+
+  for (size_t i = 0; i < SECTION_COUNT; i++) {
+    const auto &SEC = sections[i];
+    const int SX = SEC.x, SY = SEC.y, SW = SEC.width, SH = SEC.height;
+    const auto [CX, CY] = cells[i];
+    outSections[i] = {(double)CX + GUTTER, (double)CY + GUTTER, (double)SW,
+                      (double)SH};
+    if (SW <= 0 || SH <= 0)
+      continue;
+
+    const bool TILEX = isTiled(i, true);
+    const bool TILEY = isTiled(i, false);
+    const auto MAP = [](int v, int len, bool tile) {
+      return tile ? ((v % len) + len) % len : std::clamp(v, 0, len - 1);
+    };
+
+    for (int dy = -GUTTER; dy < SH + GUTTER; dy++) {
+      const auto SRCY = SY + MAP(dy, SH, TILEY);
+      auto *dst = outImage.pixels.data() +
+                  ((size_t)(CY + GUTTER + dy) * width + CX) * BPP;
+      for (int dx = -GUTTER; dx < SW + GUTTER; dx++) {
+        const auto SRCX = SX + MAP(dx, SW, TILEX);
+        std::memcpy(dst + (size_t)(dx + GUTTER) * BPP,
+                    image.pixels.data() + ((size_t)SRCY * SRCW + SRCX) * BPP,
+                    BPP);
+      }
+    }
+  }
+
+  return true;
+}
+
+bool ThemeUtils::resampleSections(
+    const SImageData &image, const std::array<CBox, SECTION_COUNT> &sections,
+    float factor, SImageData &outImage,
+    std::array<CBox, SECTION_COUNT> &outSections) {
+  if (image.type != GL_UNSIGNED_BYTE || image.format != GL_RGBA ||
+      factor <= 0.F)
+    return false;
+
+  std::array<std::pair<int, int>, SECTION_COUNT> sizes;
+  int width = 0, height = 0;
+  for (size_t i = 0; i < SECTION_COUNT; i++) {
+    const auto &SEC = sections[i];
+    if (SEC.width <= 0 || SEC.height <= 0) {
+      sizes[i] = {0, 0};
+      continue;
+    }
+    sizes[i] = {std::max(1, (int)std::lround(SEC.width * factor)),
+                std::max(1, (int)std::lround(SEC.height * factor))};
+    width += sizes[i].first;
+    height = std::max(height, sizes[i].second);
+  }
+  if (!width || !height)
+    return false;
+
+  outImage = image;
+  outImage.size = {(double)width, (double)height};
+  outImage.pixels.assign((size_t)width * height * 4, 0);
+  outImage.mipLevels = 0;
+
+  const size_t SRCSTRIDE = (size_t)image.size.x * 4;
+  const size_t DSTSTRIDE = (size_t)width * 4;
+  int x = 0;
+  for (size_t i = 0; i < SECTION_COUNT; i++) {
+    const auto &SEC = sections[i];
+    const auto [W, H] = sizes[i];
+    outSections[i] = {(double)x, 0, (double)W, (double)H};
+    if (!W)
+      continue;
+
+    ImgUtils::resample(image.pixels.data() + (size_t)SEC.y * SRCSTRIDE +
+                           (size_t)SEC.x * 4,
+                       SRCSTRIDE, (int)SEC.width, (int)SEC.height,
+                       outImage.pixels.data() + (size_t)x * 4, DSTSTRIDE, W,
+                       H, isTiled(i, true), isTiled(i, false),
+                       !image.noAlpha);
+    x += W;
+  }
+
+  return true;
+}
+
+void ThemeUtils::stackFrames(const std::vector<SImageData> &frames,
+                             SImageData &outImage) {
+  outImage = frames.front();
+  outImage.size.y = 0;
+  outImage.pixels.clear();
+  for (const auto &FRAME : frames) {
+    outImage.size.y += FRAME.size.y;
+    outImage.pixels.insert(outImage.pixels.end(), FRAME.pixels.begin(),
+                           FRAME.pixels.end());
+  }
+}
+
+std::array<CBox, SECTION_COUNT>
+ThemeUtils::offsetSections(const std::array<CBox, SECTION_COUNT> &sections,
+                           double dy) {
+  auto out = sections;
+  for (auto &box : out)
+    box.y += dy;
+  return out;
+}
+
+eSectionClass ThemeUtils::classify(const SSectionCoverage &coverage) {
+  if (!coverage.translucent && !coverage.opaque)
+    return SECTION_EMPTY;
+  if (!coverage.transparent && !coverage.translucent)
+    return SECTION_OPAQUE;
+  return SECTION_MIXED;
+}
+
+void ThemeUtils::updateMasks(SBorderTheme &theme) {
+  theme.opaqueMask = 0;
+  theme.mixedMask = 0;
+  for (size_t i = 0; i < SECTION_COUNT; i++) {
+    switch (classify(theme.coverage[i])) {
+    case SECTION_OPAQUE:
+      theme.opaqueMask |= 1u << i;
+      break;
+    case SECTION_MIXED:
+      theme.mixedMask |= 1u << i;
+      break;
+    default:
+      break;
+    }
+  }
+}
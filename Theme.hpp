@@ -0,0 +1,181 @@
+#pragma once
+
+#include "ImgUtils.hpp"
+#include <array>
+#include <cstdint>
+#include <hyprland/src/render/Texture.hpp>
+#include <string>
+#include <vector>
+
+// Everything that affects the pixels of a sliced theme
+struct SThemeKey {
+  std::string path;
+  int64_t mtime = 0;
+  std::array<int, 4> sizes = {};
+  std::array<int, 4> horSizes = {};
+  std::array<int, 4> verSizes = {};
+  bool mipmap = false;
+  // RGB565 and RGBA4 may be used where they're lossless
+  bool compact16 = false;
+  // Animation frames stacked top to bottom in the image, each laid out like
+  // a still image
+  int frames = 1;
+  // 2 if the image has a second set of frames below the first, drawn for the
+  // focused window
+  int states = 1;
+
+  bool operator==(const SThemeKey &) const = default;
+};
+
+struct SThemeKeyHash {
+  size_t operator()(const SThemeKey &key) const;
+};
+
+// Drawn sections of a theme, in the order the border shader expects them.
+// Edges go from their start (left / top) to their end.
+enum eBorderSection : uint8_t {
+  SECTION_TL = 0,
+  SECTION_TR,
+  SECTION_BR,
+  SECTION_BL,
+
+  SECTION_TLE,
+  SECTION_TLC,
+  SECTION_TME,
+  SECTION_TRC,
+  SECTION_TRE,
+
+  SECTION_RTE,
+  SECTION_RTC,
+  SECTION_RME,
+  SECTION_RBC,
+  SECTION_RBE,
+
+  SECTION_BLE,
+  SECTION_BLC,
+  SECTION_BME,
+  SECTION_BRC,
+  SECTION_BRE,
+
+  SECTION_LTE,
+  SECTION_LTC,
+  SECTION_LME,
+  SECTION_LBC,
+  SECTION_LBE,
+
+  SECTION_COUNT,
+};
+
+// How a section's pixels split by alpha. Transparent ones are never drawn.
+struct SSectionCoverage {
+  uint32_t transparent = 0;
+  uint32_t translucent = 0;
+  uint32_t opaque = 0;
+};
+
+enum eSectionClass : uint8_t {
+  SECTION_EMPTY = 0, // nothing to draw
+  SECTION_OPAQUE,    // no blending needed, hides what's below
+  SECTION_MIXED,
+};
+
+// A copy of a theme resampled on the CPU for one product of monitor and
+// border scale, so a monitor at that scale samples it 1:1. Section sizes are
+// only close to the theme's scaled ones, layout keeps going by the theme.
+struct SThemeVariant {
+  float factor = 1.F;
+  // Null while it's being built, or if that failed
+  SP<CTexture> atlas;
+  std::array<CBox, SECTION_COUNT> sections;
+  float gutter = 0;
+  size_t bytes = 0;
+  // The load building it, results of earlier ones are dropped
+  uint64_t loadId = 0;
+};
+
+// One border image on the GPU, with its sections described as sub-rects of
+// it. Shared by every window that uses the same image and slice parameters,
+// freed with the last reference.
+struct SBorderTheme {
+  SThemeKey key;
+
+  // The whole image, sampled by the border shader. Null until the image has
+  // been decoded and uploaded.
+  SP<CTexture> atlas;
+
+  // Of the file the atlas was decoded from
+  uint64_t contentHash = 0;
+
+  // Video memory used by the atlas, and what it's stored as
+  size_t bytes = 0;
+  const char *format = "";
+  // Half float themes are composed into half float textures too
+  bool hdr = false;
+
+  // Where each section lives in the atlas, in pixels
+  std::array<CBox, SECTION_COUNT> sections;
+
+  // With mipmaps every section sits in its own cell, with this many pixels
+  // of wrapped or extended content around it
+  float gutter = 0;
+  int mipLevels = 0;
+
+  // Summed over every frame, so sections are only opaque or empty if they
+  // are in all of them
+  std::array<SSectionCoverage, SECTION_COUNT> coverage;
+
+  // Frames are frameHeight pixels apart in the atlas, sections are where
+  // they are in the first. The focused look's frames follow the others.
+  int frames = 1;
+  int states = 1;
+  float frameHeight = 0;
+
+  // Bit per section, by class. Empty sections are in neither.
+  uint32_t opaqueMask = 0;
+  uint32_t mixedMask = 0;
+
+  // Of the current atlas, by factor
+  std::vector<SP<SThemeVariant>> variants;
+};
+
+namespace ThemeUtils {
+// Cuts an image of the given size into the sections the key describes
+std::array<CBox, SECTION_COUNT> layoutSections(const SThemeKey &key,
+                                               const Vector2D &imageSize);
+
+// Sorts every section's pixels by alpha. Safe off the main thread.
+std::array<SSectionCoverage, SECTION_COUNT>
+measureCoverage(const SImageData &image,
+                const std::array<CBox, SECTION_COUNT> &sections);
+
+// Tiled runs repeat along their edge, everything else is stretched
+bool isTiled(size_t section, bool horizontal);
+
+// Copies every section into its own cell with a gutter that repeats tiled
+// runs and extends everything else. Cells line up with every mip level up to
+// levels, so a mip chain built from the result never mixes sections. Returns
+// false for formats that can't be mipmapped.
+bool padSections(const SImageData &image,
+                 const std::array<CBox, SECTION_COUNT> &sections, int levels,
+                 SImageData &outImage,
+                 std::array<CBox, SECTION_COUNT> &outSections);
+
+// Resamples every section by factor, tiled runs seamlessly, into a new image
+// with the sections side by side. Only 8-bit RGBA images can be resampled.
+bool resampleSections(const SImageData &image,
+                      const std::array<CBox, SECTION_COUNT> &sections,
+                      float factor, SImageData &outImage,
+                      std::array<CBox, SECTION_COUNT> &outSections);
+
+// Puts images of the same width and format one below the other
+void stackFrames(const std::vector<SImageData> &frames, SImageData &outImage);
+
+// Moves every section down by dy pixels
+std::array<CBox, SECTION_COUNT>
+offsetSections(const std::array<CBox, SECTION_COUNT> &sections, double dy);
+
+eSectionClass classify(const SSectionCoverage &coverage);
+
+// Fills the theme's section masks from its coverage
+void updateMasks(SBorderTheme &theme);
+} // namespace ThemeUtils
@@ -0,0 +1,309 @@
+#include "ThemeCache.hpp"
+#include "ImgBorder.hpp"
+#include "ImgUtils.hpp"
+#include "globals.hpp"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <hyprland/src/debug/Log.hpp>
+#include <hyprland/src/render/Renderer.hpp>
+
+bool CThemeCache::makeKey(const std::string &path, SThemeKey &outKey) {
+  std::error_code ec;
+  const auto MTIME = std::filesystem::last_write_time(path, ec);
+  if (ec)
+    return false;
+
+  outKey.path = path;
+  outKey.mtime = MTIME.time_since_epoch().count();
+  return true;
+}
+
+CThemeCache::CThemeCache()
+    : m_loader([this](SDecodeResult &result) { onDecoded(result); }),
+      m_watcher([this](const std::string &path) { onFileChanged(path); }) {}
+
+SP<SBorderTheme> CThemeCache::get(const SThemeKey &key) {
+  if (const auto IT = m_themes.find(key); IT != m_themes.end()) {
+    if (auto theme = IT->second.lock()) {
+      m_hits++;
+      return theme;
+    }
+  }
+
+  // Drop entries whose last user went away, and stop watching their images
+  std::erase_if(m_themes, [](const auto &e) { return e.second.expired(); });
+  std::erase_if(m_watched, [this](const std::string &path) {
+    if (std::ranges::any_of(m_themes,
+                            [&](const auto &e) { return e.first.path == path; }))
+      return false;
+    m_watcher.unwatch(path);
+    return true;
+  });
+
+  m_misses++;
+  Debug::log(LOG, "[imgborders] theme cache miss for {}, loading", key.path);
+
+  auto theme = makeShared<SBorderTheme>();
+  theme->key = key;
+  m_themes[key] = theme;
+
+  if (std::ranges::find(m_watched, key.path) == m_watched.end()) {
+    m_watcher.watch(key.path);
+    m_watched.push_back(key.path);
+  }
+
+  const auto ID = m_nextLoadId++;
+  m_loading[ID] = theme;
+  m_loader.queue({.id = ID, .key = key});
+
+  return theme;
+}
+
+// Factors closer than this share a variant
+constexpr float VARIANT_EPSILON = 0.001F;
+
+SP<SThemeVariant> CThemeCache::variant(const SP<SBorderTheme> &theme,
+                                       float factor) {
+  // The resampler only takes 8-bit pixels, and single frames
+  if (!theme || !theme->atlas || theme->hdr || theme->frames > 1 ||
+      theme->states > 1 ||
+      std::abs(factor - 1.F) < VARIANT_EPSILON)
+    return nullptr;
+
+  const auto IT = std::ranges::find_if(theme->variants, [factor](const auto &v) {
+    return std::abs(v->factor - factor) < VARIANT_EPSILON;
+  });
+  if (IT != theme->variants.end())
+    return (*IT)->atlas ? *IT : nullptr;
+
+  auto variant = makeShared<SThemeVariant>();
+  variant->factor = factor;
+  variant->loadId = m_nextLoadId++;
+  theme->variants.push_back(variant);
+
+  m_loading[variant->loadId] = theme;
+  m_loader.queue(
+      {.id = variant->loadId, .key = theme->key, .resample = factor});
+
+  return nullptr;
+}
+
+void CThemeCache::pruneVariants(const std::vector<float> &factors) {
+  for (const auto &[KEY, WEAK] : m_themes) {
+    const auto THEME = WEAK.lock();
+    if (!THEME)
+      continue;
+
+    std::erase_if(THEME->variants, [&factors](const auto &v) {
+      return std::ranges::none_of(factors, [&v](float f) {
+        return std::abs(v->factor - f) < VARIANT_EPSILON;
+      });
+    });
+  }
+}
+
+void CThemeCache::logUsage() {
+  size_t total = 0;
+  for (const auto &[KEY, WEAK] : m_themes) {
+    const auto THEME = WEAK.lock();
+    if (!THEME || !THEME->bytes)
+      continue;
+
+    size_t variants = 0;
+    for (const auto &v : THEME->variants)
+      variants += v->bytes;
+    total += THEME->bytes + variants;
+
+    // What it would take as plain RGBA8, mips and variants aside
+    const auto RGBA8 = (size_t)THEME->atlas->m_size.x *
+                       (size_t)THEME->atlas->m_size.y * 4;
+    Debug::log(LOG,
+               "[imgborders] theme {}: {} KiB as {} (RGBA8 {} KiB), {} KiB "
+               "in {} variant(s)",
+               KEY.path, THEME->bytes >> 10, THEME->format, RGBA8 >> 10,
+               variants >> 10, THEME->variants.size());
+  }
+  Debug::log(LOG, "[imgborders] themes use {} KiB of video memory",
+             total >> 10);
+}
+
+void CThemeCache::usage(size_t &outTextures, size_t &outBytes) const {
+  for (const auto &[KEY, WEAK] : m_themes) {
+    const auto THEME = WEAK.lock();
+    if (!THEME || !THEME->bytes)
+      continue;
+
+    outTextures++;
+    outBytes += THEME->bytes;
+    for (const auto &v : THEME->variants) {
+      if (!v->bytes)
+        continue;
+      outTextures++;
+      outBytes += v->bytes;
+    }
+  }
+}
+
+void CThemeCache::stop() {
+  m_loader.stop();
+  m_loading.clear();
+  m_watcher.stop();
+  m_watched.clear();
+}
+
+void CThemeCache::updateMtime(const SP<SBorderTheme> &theme, int64_t mtime) {
+  if (!mtime || theme->key.mtime == mtime)
+    return;
+
+  if (const auto IT = m_themes.find(theme->key);
+      IT != m_themes.end() && IT->second.lock() == theme)
+    m_themes.erase(IT);
+
+  theme->key.mtime = mtime;
+  m_themes.try_emplace(theme->key, theme);
+}
+
+void CThemeCache::onFileChanged(const std::string &path) {
+  std::vector<SP<SBorderTheme>> affected;
+  for (const auto &[KEY, WEAK] : m_themes) {
+    if (KEY.path != path)
+      continue;
+    if (auto theme = WEAK.lock())
+      affected.push_back(std::move(theme));
+  }
+
+  Debug::log(LOG, "[imgborders] {} changed, rechecking {} theme(s)", path,
+             affected.size());
+
+  for (const auto &theme : affected) {
+    const auto ID = m_nextLoadId++;
+    m_loading[ID] = theme;
+    m_loader.queue({
+        .id = ID,
+        .key = theme->key,
+        .knownHash = theme->atlas ? std::optional(theme->contentHash)
+                                  : std::nullopt,
+    });
+  }
+}
+
+void CThemeCache::onDecoded(SDecodeResult &result) {
+  const auto IT = m_loading.find(result.id);
+  if (IT == m_loading.end())
+    return;
+
+  const auto THEME = IT->second.lock();
+  m_loading.erase(IT);
+
+  // Replaced by another reload before it finished
+  if (!THEME)
+    return;
+
+  auto &stats = g_pGlobalState->stats;
+  if (result.loadNs)
+    stats.record(STAT_LOAD, result.loadNs);
+  if (result.sliceNs)
+    stats.record(STAT_SLICE, result.sliceNs);
+
+  if (result.resample > 0.F) {
+    onVariantDecoded(THEME, result);
+    return;
+  }
+
+  if (!result.ok) {
+    Debug::log(ERR, "[imgborders] failed to load {} ({})", result.path,
+               result.error);
+    // A bad rewrite keeps the last good image
+    if (THEME->atlas)
+      return;
+  }
+
+  updateMtime(THEME, result.mtime);
+
+  // Touched, but the same pixels
+  if (result.unchanged)
+    return;
+
+  g_pHyprRenderer->makeEGLCurrent();
+
+  // Resampled from the old pixels
+  THEME->variants.clear();
+
+  if (result.ok) {
+    CStatTimer timer(stats, STAT_UPLOAD);
+    THEME->atlas = ImgUtils::upload(result.image);
+    THEME->bytes = ImgUtils::textureBytes(result.image);
+    THEME->format = ImgUtils::formatName(result.image);
+    THEME->hdr = result.image.type == GL_HALF_FLOAT;
+    THEME->contentHash = result.hash;
+    THEME->sections = result.sections;
+    THEME->coverage = result.coverage;
+    THEME->gutter = result.gutter;
+    THEME->mipLevels = result.image.mipLevels;
+    THEME->frames = std::max(1, THEME->key.frames);
+    THEME->states = std::max(1, THEME->key.states);
+  } else {
+    THEME->atlas = ImgUtils::invalidTexture();
+    THEME->bytes = 0;
+    THEME->format = "";
+    THEME->hdr = false;
+    THEME->gutter = 0;
+    THEME->mipLevels = 0;
+    THEME->frames = 1;
+    THEME->states = 1;
+    THEME->sections =
+        ThemeUtils::layoutSections(THEME->key, THEME->atlas->m_size);
+    // The checkerboard has no alpha
+    for (size_t i = 0; i < SECTION_COUNT; i++)
+      THEME->coverage[i] = {
+          .opaque = (uint32_t)std::max(0.0, THEME->sections[i].width *
+                                                THEME->sections[i].height),
+      };
+  }
+
+  THEME->frameHeight =
+      THEME->atlas->m_size.y / (THEME->frames * THEME->states);
+
+  ThemeUtils::updateMasks(*THEME);
+
+  // Everyone using it or waiting for it redraws in the same frame
+  g_pGlobalState->borders.onThemeReady(THEME);
+}
+
+void CThemeCache::onVariantDecoded(const SP<SBorderTheme> &theme,
+                                   SDecodeResult &result) {
+  // Dropped, or the image changed since
+  const auto IT = std::ranges::find_if(theme->variants, [&](const auto &v) {
+    return v->loadId == result.id;
+  });
+  if (IT == theme->variants.end())
+    return;
+
+  // Read after the file was rewritten, its sections would come from pixels
+  // the atlas doesn't have. Built again on the next draw.
+  if (result.ok && result.hash != theme->contentHash) {
+    theme->variants.erase(IT);
+    return;
+  }
+
+  if (!result.ok) {
+    // Stays without an atlas, so the theme keeps being used as is
+    Debug::log(ERR, "[imgborders] no {}x variant of {} ({})", result.resample,
+               result.path, result.error);
+    return;
+  }
+
+  g_pHyprRenderer->makeEGLCurrent();
+
+  const auto &VARIANT = *IT;
+  {
+    CStatTimer timer(g_pGlobalState->stats, STAT_UPLOAD);
+    VARIANT->atlas = ImgUtils::upload(result.image);
+  }
+  VARIANT->bytes = ImgUtils::textureBytes(result.image);
+  VARIANT->sections = result.sections;
+  VARIANT->gutter = result.gutter;
+
+  g_pGlobalState->borders.onThemeReady(theme);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "FileWatcher.hpp"
+#include "Theme.hpp"
+#include "ThemeLoader.hpp"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class CThemeCache {
+public:
+  CThemeCache();
+
+  // Returns the theme for the given key. On a miss the image is decoded in the
+  // background and the theme has no atlas yet; borders waiting for it are
+  // told through CImgBorder::onThemeReady once it has one. The image is then
+  // watched, and rewrites that change its contents update the theme in place.
+  SP<SBorderTheme> get(const SThemeKey &key);
+
+  // The theme resampled for factor (monitor scale times border scale), if
+  // it's ready. The first call for a factor starts building it, the theme's
+  // borders are told through onThemeReady once it's done. Null at 1x, which
+  // the theme already is.
+  SP<SThemeVariant> variant(const SP<SBorderTheme> &theme, float factor);
+
+  // Drops every variant whose factor isn't in factors. Needs the render
+  // context current.
+  void pruneVariants(const std::vector<float> &factors);
+
+  // Logs the video memory each theme and its variants use
+  void logUsage();
+
+  // Adds the textures of every theme and variant in use, and their bytes
+  void usage(size_t &outTextures, size_t &outBytes) const;
+
+  void stop();
+
+  // Builds a key for path, reading its mtime. Returns false if the file
+  // can't be stat'ed.
+  static bool makeKey(const std::string &path, SThemeKey &outKey);
+
+  uint64_t m_hits = 0;
+  uint64_t m_misses = 0;
+
+private:
+  void onDecoded(SDecodeResult &result);
+  void onVariantDecoded(const SP<SBorderTheme> &theme, SDecodeResult &result);
+  void onFileChanged(const std::string &path);
+
+  // Moves the theme to the key matching its file's new mtime
+  void updateMtime(const SP<SBorderTheme> &theme, int64_t mtime);
+
+  std::unordered_map<SThemeKey, WP<SBorderTheme>, SThemeKeyHash> m_themes;
+
+  // Themes waiting for their image, by load id
+  std::unordered_map<uint64_t, WP<SBorderTheme>> m_loading;
+  uint64_t m_nextLoadId = 1;
+
+  CThemeLoader m_loader;
+
+  std::vector<std::string> m_watched;
+  CFileWatcher m_watcher;
+};
@@ -0,0 +1,258 @@
+#include "ThemeLoader.hpp"
+#include "DiskCache.hpp"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <hyprland/src/Compositor.hpp>
+#include <hyprland/src/debug/Log.hpp>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <wayland-server-core.h>
+
+CThemeLoader::CThemeLoader(FOnDecoded onDecoded)
+    : m_onDecoded(std::move(onDecoded)) {}
+
+CThemeLoader::~CThemeLoader() { stop(); }
+
+bool CThemeLoader::start() {
+  if (m_thread.joinable())
+    return true;
+
+  if (!g_pCompositor || !g_pCompositor->m_wlEventLoop)
+    return false;
+
+  m_eventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (m_eventFd < 0) {
+    Debug::log(ERR, "[imgborders] eventfd failed: {}", strerror(errno));
+    return false;
+  }
+
+  m_eventSource = wl_event_loop_add_fd(g_pCompositor->m_wlEventLoop, m_eventFd,
+                                       WL_EVENT_READABLE, onEventFd, this);
+  if (!m_eventSource) {
+    close(m_eventFd);
+    m_eventFd = -1;
+    return false;
+  }
+
+  m_stopping = false;
+  m_thread = std::thread([this] { work(); });
+  return true;
+}
+
+void CThemeLoader::stop() {
+  if (m_thread.joinable()) {
+    {
+      std::lock_guard lk(m_mutex);
+      m_stopping = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+  }
+
+  if (m_eventSource) {
+    wl_event_source_remove(m_eventSource);
+    m_eventSource = nullptr;
+  }
+  if (m_eventFd >= 0) {
+    close(m_eventFd);
+    m_eventFd = -1;
+  }
+
+  m_queued.clear();
+  m_done.clear();
+  m_source = {};
+}
+
+// Down to 1/16th, past that borders are a few pixels thick anyway
+constexpr int MIP_LEVELS = 4;
+
+static uint64_t nsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// Runs on the worker
+static SDecodeResult process(const SDecodeJob &job, SDecodedSource &source) {
+  const auto START = std::chrono::steady_clock::now();
+  SDecodeResult result = {
+      .id = job.id, .path = job.key.path, .resample = job.resample};
+
+  std::vector<uint8_t> bytes;
+  if (!ImgUtils::readFile(result.path, bytes, result.error))
+    return result;
+
+  std::error_code ec;
+  const auto MTIME = std::filesystem::last_write_time(result.path, ec);
+  result.mtime = ec ? 0 : MTIME.time_since_epoch().count();
+
+  result.hash = ImgUtils::contentHash(bytes);
+  if (job.knownHash == result.hash) {
+    result.ok = true;
+    result.unchanged = true;
+    return result;
+  }
+
+  // Seen before, as long as it's not a variant
+  if (job.resample <= 0.F && DiskCache::load(job, result)) {
+    result.ok = true;
+    result.loadNs = nsSince(START);
+    return result;
+  }
+
+  // Variants of the image decoded last start from its pixels
+  const bool REUSE = job.resample > 0.F && source.hash == result.hash &&
+                     source.path == result.path && !source.image.pixels.empty();
+  if (REUSE)
+    result.image = source.image;
+  result.ok = REUSE || ImgUtils::decode(bytes, result.image, result.error);
+  result.loadNs = nsSince(START);
+  if (!result.ok)
+    return result;
+
+  // Every frame of either state is laid out the same, sections are where
+  // they are in the first one
+  const int FRAMES = std::max(1, job.key.frames) * std::max(1, job.key.states);
+  if ((int)result.image.size.y % FRAMES != 0) {
+    result.ok = false;
+    result.error = std::format("{} pixels high, not a multiple of {} frames",
+                               result.image.size.y, FRAMES);
+    return result;
+  }
+  const double FRAMEHEIGHT = result.image.size.y / FRAMES;
+  result.sections = ThemeUtils::layoutSections(
+      job.key, {result.image.size.x, FRAMEHEIGHT});
+
+  // What variants can be made from, see CThemeCache::variant
+  if (!REUSE && FRAMES == 1 && result.image.type == GL_UNSIGNED_BYTE)
+    source = {.path = result.path, .hash = result.hash, .image = result.image};
+
+  if (job.resample > 0.F) {
+    SImageData resampled;
+    std::array<CBox, SECTION_COUNT> sections;
+    result.ok = ThemeUtils::resampleSections(result.image, result.sections,
+                                             job.resample, resampled,
+                                             sections) &&
+                ThemeUtils::padSections(resampled, sections, 0, result.image,
+                                        result.sections);
+    if (result.ok)
+      ImgUtils::compact(result.image, job.key.compact16);
+    else
+      result.error = "can't be resampled";
+    // A pixel of wrapped or extended content keeps filtering inside
+    result.gutter = 1;
+    result.sliceNs = nsSince(START) - result.loadNs;
+    return result;
+  }
+
+  for (int f = 0; f < FRAMES; f++) {
+    const auto COVERAGE = ThemeUtils::measureCoverage(
+        result.image,
+        ThemeUtils::offsetSections(result.sections, f * FRAMEHEIGHT));
+    for (size_t i = 0; i < SECTION_COUNT; i++) {
+      result.coverage[i].transparent += COVERAGE[i].transparent;
+      result.coverage[i].translucent += COVERAGE[i].translucent;
+      result.coverage[i].opaque += COVERAGE[i].opaque;
+    }
+  }
+
+  if (job.key.mipmap) {
+    // Padded frame by frame, cells come out the same in each. Their heights
+    // are whole cells, so stacked frames don't mix in the mips either.
+    std::vector<SImageData> padded(FRAMES);
+    std::array<CBox, SECTION_COUNT> sections;
+    bool ok = true;
+    for (int f = 0; f < FRAMES && ok; f++)
+      ok = ThemeUtils::padSections(
+          result.image,
+          ThemeUtils::offsetSections(result.sections, f * FRAMEHEIGHT),
+          MIP_LEVELS, padded[f], sections);
+    if (ok) {
+      ThemeUtils::stackFrames(padded, result.image);
+      result.sections = sections;
+      result.gutter = 1 << MIP_LEVELS;
+    }
+  }
+
+  // Last, everything before wants 8-bit RGBA
+  ImgUtils::compact(result.image, job.key.compact16);
+  result.sliceNs = nsSince(START) - result.loadNs;
+
+  DiskCache::store(job, result);
+
+  return result;
+}
+
+void CThemeLoader::queue(SDecodeJob job) {
+  if (!start()) {
+    // No event loop to come back on, do it the slow way
+    auto result = process(job, m_source);
+    m_onDecoded(result);
+    return;
+  }
+
+  {
+    std::lock_guard lk(m_mutex);
+    m_queued.emplace_back(std::move(job));
+  }
+  m_cv.notify_one();
+}
+
+void CThemeLoader::work() {
+  while (true) {
+    SDecodeJob job;
+    {
+      std::unique_lock lk(m_mutex);
+      m_cv.wait(lk, [this] { return m_stopping || !m_queued.empty(); });
+      if (m_stopping)
+        return;
+      job = std::move(m_queued.front());
+      m_queued.pop_front();
+    }
+
+    auto result = process(job, m_source);
+
+    {
+      std::lock_guard lk(m_mutex);
+      m_done.emplace_back(std::move(result));
+    }
+
+    // Lost, the result would wait for the next one to be delivered
+    const uint64_t ONE = 1;
+    ssize_t written;
+    do {
+      written = write(m_eventFd, &ONE, sizeof(ONE));
+    } while (written < 0 && errno == EINTR);
+    if (written < 0)
+      Debug::log(ERR, "[imgborders] can't wake the compositor: {}",
+                 strerror(errno));
+  }
+}
+
+void CThemeLoader::deliver() {
+  std::deque<SDecodeResult> done;
+  {
+    std::lock_guard lk(m_mutex);
+    done.swap(m_done);
+  }
+
+  for (auto &result : done)
+    m_onDecoded(result);
+}
+
+int CThemeLoader::onEventFd(int fd, uint32_t mask, void *data) {
+  // EAGAIN only means another wakeup already drained it
+  uint64_t count = 0;
+  ssize_t got;
+  do {
+    got = read(fd, &count, sizeof(count));
+  } while (got < 0 && errno == EINTR);
+  if (got < 0 && errno != EAGAIN)
+    Debug::log(ERR, "[imgborders] eventfd read failed: {}", strerror(errno));
+
+  static_cast<CThemeLoader *>(data)->deliver();
+  return 0;
+}
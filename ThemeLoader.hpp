@@ -0,0 +1,103 @@
+#pragma once
+
+#include "ImgUtils.hpp"
+#include "Theme.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+struct wl_event_source;
+
+struct SDecodeJob {
+  uint64_t id = 0;
+  // Image and how it's cut into sections
+  SThemeKey key;
+
+  // Hash of the contents already on screen. If the file still hashes to it,
+  // decoding is skipped.
+  std::optional<uint64_t> knownHash;
+
+  // Builds a variant resampled by this factor instead, see SThemeVariant
+  float resample = 0.F;
+};
+
+// What the worker hands back for one queued image
+struct SDecodeResult {
+  uint64_t id = 0;
+  std::string path;
+  float resample = 0.F;
+  bool ok = false;
+  std::string error;
+
+  // Contents hash to knownHash, image is empty
+  bool unchanged = false;
+  uint64_t hash = 0;
+  int64_t mtime = 0;
+  SImageData image;
+
+  // Filled when the image was decoded
+  std::array<CBox, SECTION_COUNT> sections;
+  std::array<SSectionCoverage, SECTION_COUNT> coverage;
+  float gutter = 0;
+
+  // Spent reading and decoding, or loading from the disk cache, and then
+  // slicing. 0 for steps that didn't run.
+  uint64_t loadNs = 0;
+  uint64_t sliceNs = 0;
+};
+
+// One version of an image as decoded, before it's cut up or compacted
+struct SDecodedSource {
+  std::string path;
+  uint64_t hash = 0;
+  SImageData image;
+};
+
+// Reads, decodes and analyses theme images on a worker thread. Results are delivered on
+// the compositor thread through its event loop, so the callback can touch GL
+// and the rest of the plugin freely.
+class CThemeLoader {
+public:
+  using FOnDecoded = std::function<void(SDecodeResult &)>;
+
+  explicit CThemeLoader(FOnDecoded onDecoded);
+  ~CThemeLoader();
+
+  // The result comes back tagged with the job's id. If the worker can't be
+  // started the image is decoded right away and delivered before this returns.
+  void queue(SDecodeJob job);
+
+  // Joins the worker and leaves the event loop. Results not delivered yet are
+  // dropped.
+  void stop();
+
+private:
+  bool start();
+  void work();
+  void deliver();
+
+  static int onEventFd(int fd, uint32_t mask, void *data);
+
+  FOnDecoded m_onDecoded;
+
+  // The last 8-bit single frame image decoded, which variants of it are
+  // resampled from instead of inflating the file again. Only the worker
+  // touches it.
+  SDecodedSource m_source;
+
+  std::thread m_thread;
+  int m_eventFd = -1;
+  wl_event_source *m_eventSource = nullptr;
+
+  // Everything below is shared with the worker
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::deque<SDecodeJob> m_queued;
+  std::deque<SDecodeResult> m_done;
+  bool m_stopping = false;
+};
@@ -0,0 +1,453 @@
+// Measures what the plugin costs outside the compositor, on a surfaceless EGL
+// context (Mesa's llvmpipe needs no GPU). Loads, slices and uploads a theme
+// the way ThemeLoader does, then lays out and draws scenes of 1 to 500
+// windows and storms of theme reloads with the border shader itself.
+//
+//   imgborders-bench [image sizes horsizes versizes]
+//
+// Without arguments a generated image is used. Times are per operation,
+// draws are waited for with glFinish.
+
+#include "BorderLayout.hpp"
+#include "BorderProgram.hpp"
+#include "BorderShaderSource.hpp"
+#include "ImgUtils.hpp"
+#include "Theme.hpp"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl32.h>
+#include <array>
+#include <cairo/cairo.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <format>
+#include <string>
+#include <vector>
+
+// Same as ThemeLoader
+constexpr int MIP_LEVELS = 4;
+
+// Every measurement runs at least this long
+constexpr auto MIN_TIME = std::chrono::milliseconds(200);
+
+// Scenes are drawn onto a 4K monitor
+constexpr int OUTPUT_W = 3840;
+constexpr int OUTPUT_H = 2160;
+
+constexpr std::array WINDOW_COUNTS = {1, 10, 50, 100, 250, 500};
+constexpr int STORM_WINDOWS = 100;
+// Section layout alone, with window sizes all over the place
+constexpr int LAYOUT_BATCH = 1000;
+constexpr int STORM_RELOADS = 20;
+
+// GL work done by the bench, reported next to the times
+struct SCounters {
+  size_t draws = 0;
+  size_t uploads = 0;
+  size_t uploadBytes = 0;
+};
+static SCounters counters;
+
+// Textures currently allocated, and their size
+static size_t texturesAlive = 0;
+static size_t bytesAlive = 0;
+
+struct STheme {
+  SImageData image;
+  SBorderTheme theme;
+  GLuint tex = 0;
+};
+
+static bool makeContext() {
+  const auto GETDISPLAY = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+      "eglGetPlatformDisplayEXT");
+  if (!GETDISPLAY)
+    return false;
+
+  const auto DISPLAY = GETDISPLAY(EGL_PLATFORM_SURFACELESS_MESA,
+                                  EGL_DEFAULT_DISPLAY, nullptr);
+  if (DISPLAY == EGL_NO_DISPLAY || !eglInitialize(DISPLAY, nullptr, nullptr) ||
+      !eglBindAPI(EGL_OPENGL_ES_API))
+    return false;
+
+  const EGLint ATTRIBS[] = {EGL_CONTEXT_MAJOR_VERSION, 3,
+                            EGL_CONTEXT_MINOR_VERSION, 2, EGL_NONE};
+  const auto CONTEXT =
+      eglCreateContext(DISPLAY, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, ATTRIBS);
+  return CONTEXT != EGL_NO_CONTEXT &&
+         eglMakeCurrent(DISPLAY, EGL_NO_SURFACE, EGL_NO_SURFACE, CONTEXT);
+}
+
+// Runs fn for at least MIN_TIME after a warm-up run, returns ns per run
+template <typename F> static double measure(F &&fn) {
+  fn();
+
+  size_t runs = 0;
+  const auto START = std::chrono::steady_clock::now();
+  auto elapsed = std::chrono::steady_clock::duration{};
+  while (elapsed < MIN_TIME) {
+    fn();
+    runs++;
+    elapsed = std::chrono::steady_clock::now() - START;
+  }
+  return std::chrono::duration<double, std::nano>(elapsed).count() / runs;
+}
+
+static void report(const std::string &name, double ns,
+                   const SCounters &perOp = {}) {
+  std::printf("%-32s %14.0f %8zu %8zu %12zu\n", name.c_str(), ns, perOp.draws,
+              perOp.uploads, perOp.uploadBytes);
+}
+
+// A 96x96 frame with opaque, translucent and empty parts, as a PNG
+static std::vector<uint8_t> generateImage() {
+  const auto SURFACE = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 96, 96);
+  const auto CAIRO = cairo_create(SURFACE);
+
+  cairo_set_source_rgba(CAIRO, 0.2, 0.3, 0.8, 1);
+  cairo_rectangle(CAIRO, 0, 0, 96, 96);
+  cairo_set_line_width(CAIRO, 16);
+  cairo_stroke(CAIRO);
+  cairo_set_source_rgba(CAIRO, 0.9, 0.6, 0.1, 0.5);
+  cairo_rectangle(CAIRO, 12, 12, 72, 72);
+  cairo_set_line_width(CAIRO, 8);
+  cairo_stroke(CAIRO);
+  cairo_destroy(CAIRO);
+
+  std::vector<uint8_t> png;
+  cairo_surface_write_to_png_stream(
+      SURFACE,
+      [](void *closure, const unsigned char *data, unsigned int length) {
+        auto &out = *static_cast<std::vector<uint8_t> *>(closure);
+        out.insert(out.end(), data, data + length);
+        return CAIRO_STATUS_SUCCESS;
+      },
+      &png);
+  cairo_surface_destroy(SURFACE);
+  return png;
+}
+
+static bool parseInts(const char *str, std::array<int, 4> &out) {
+  return std::sscanf(str, "%d,%d,%d,%d", &out[0], &out[1], &out[2],
+                     &out[3]) == 4;
+}
+
+// Decode to upload, like ThemeLoader::process and CThemeCache without the
+// disk cache. out is reused between runs, its texture already unloaded.
+static bool loadTheme(const std::vector<uint8_t> &png, const SThemeKey &key,
+                      STheme &out) {
+  // Fresh every time, like a result of the loader
+  out = {};
+  std::string error;
+  if (!ImgUtils::decode(png, out.image, error)) {
+    std::fprintf(stderr, "can't decode: %s\n", error.c_str());
+    return false;
+  }
+
+  auto &theme = out.theme;
+  theme.key = key;
+  theme.sections = ThemeUtils::layoutSections(key, out.image.size);
+  theme.coverage = ThemeUtils::measureCoverage(out.image, theme.sections);
+  theme.frameHeight = out.image.size.y;
+  if (key.mipmap) {
+    SImageData padded;
+    std::array<CBox, SECTION_COUNT> sections;
+    if (ThemeUtils::padSections(out.image, theme.sections, MIP_LEVELS, padded,
+                                sections)) {
+      out.image = std::move(padded);
+      theme.sections = sections;
+      theme.gutter = 1 << MIP_LEVELS;
+    }
+  }
+  ImgUtils::compact(out.image, key.compact16);
+  ThemeUtils::updateMasks(theme);
+
+  glGenTextures(1, &out.tex);
+  glBindTexture(GL_TEXTURE_2D, out.tex);
+  ImgUtils::texImage(out.image);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  theme.bytes = ImgUtils::textureBytes(out.image);
+  theme.mipLevels = out.image.mipLevels;
+  counters.uploads++;
+  counters.uploadBytes += theme.bytes;
+  texturesAlive++;
+  bytesAlive += theme.bytes;
+  return true;
+}
+
+static void unloadTheme(STheme &theme) {
+  glDeleteTextures(1, &theme.tex);
+  theme.tex = 0;
+  texturesAlive--;
+  bytesAlive -= theme.theme.bytes;
+}
+
+// What CImgBorder::updateLayout passes, with the default 25/75 placements
+static BorderLayout::SParams layoutParams(const SBorderTheme &theme) {
+  const auto &SIZES = theme.key.sizes;
+  const auto LENGTH = [&](eBorderSection section, bool horizontal) {
+    const auto &SEC = theme.sections[section];
+    return (float)(horizontal ? SEC.width : SEC.height);
+  };
+  return {
+      .borders = {(float)SIZES[0], (float)SIZES[1], (float)SIZES[2],
+                  (float)SIZES[3]},
+      .placements = {25, 75, 25, 75, 25, 75, 25, 75},
+      .customLengths = {LENGTH(SECTION_TLC, true), LENGTH(SECTION_TRC, true),
+                        LENGTH(SECTION_RTC, false), LENGTH(SECTION_RBC, false),
+                        LENGTH(SECTION_BLC, true), LENGTH(SECTION_BRC, true),
+                        LENGTH(SECTION_LTC, false),
+                        LENGTH(SECTION_LBC, false)},
+  };
+}
+
+// Sizes of count windows tiled over the output
+static void tileScene(int count, BorderLayout::SBatch &batch) {
+  const int COLS = (int)std::ceil(std::sqrt((double)count));
+  const int ROWS = (count + COLS - 1) / COLS;
+  batch.resize(count);
+  for (int i = 0; i < count; i++) {
+    batch.width[i] = (float)OUTPUT_W / COLS - 8;
+    batch.height[i] = (float)OUTPUT_H / ROWS - 8;
+  }
+}
+
+// count windows tiled over the output, laid out in one batch
+static void layoutScene(int count, const BorderLayout::SParams &params,
+                        BorderLayout::SBatch &batch,
+                        std::vector<SBorderInstance> &out) {
+  tileScene(count, batch);
+  BorderLayout::layout(params, batch);
+
+  const int COLS = (int)std::ceil(std::sqrt((double)count));
+  const auto &P = batch.placements;
+  const size_t N = count;
+  out.resize(count);
+  for (size_t i = 0; i < N; i++) {
+    auto &instance = out[i];
+    instance.box = {(i % COLS) * (batch.width[i] + 8.0) + 4,
+                    (i / COLS) * (batch.height[i] + 8.0) + 4, batch.width[i],
+                    batch.height[i]};
+    instance.placementsH = {P[i], P[N + i], P[4 * N + i], P[5 * N + i]};
+    instance.placementsV = {P[2 * N + i], P[3 * N + i], P[6 * N + i],
+                            P[7 * N + i]};
+    instance.a = 1.F;
+  }
+}
+
+static void pack(const std::vector<SBorderInstance> &instances,
+                 std::vector<float> &out) {
+  out.clear();
+  for (const auto &INSTANCE : instances)
+    BorderProgram::pack(INSTANCE, INSTANCE.box, out);
+}
+
+// Binds like CBorderShader::bind, straight to the output in pixels
+static void bind(const BorderProgram::SProgram &program, const STheme &theme) {
+  const auto &SIZES = theme.theme.key.sizes;
+  const SBorderStyle STYLE = {
+      .borders = {(float)SIZES[0], (float)SIZES[1], (float)SIZES[2],
+                  (float)SIZES[3]},
+  };
+  const std::array<float, 9> PROJ = {
+      2.F / OUTPUT_W, 0.F, -1.F, //
+      0.F, 2.F / OUTPUT_H, -1.F, //
+      0.F, 0.F, 1.F,             //
+  };
+
+  glUseProgram(program.program);
+  BorderProgram::bind(program, theme.theme, nullptr, STYLE, PROJ, theme.tex,
+                      theme.image.size);
+}
+
+// The draw sequence of CBorderShader::draw with opaquePass, over full damage.
+// Batched draws every instance at once, otherwise one window at a time like
+// plugin:imgborders:batch = false.
+static void drawScene(const BorderProgram::SProgram &program, const STheme &theme,
+                      const std::vector<float> &packed, size_t count,
+                      bool batched) {
+  const auto &THEME = theme.theme;
+  bind(program, theme);
+
+  const std::array<std::pair<uint32_t, bool>, 2> PASSES = {{
+      {THEME.opaqueMask, false},
+      {THEME.mixedMask, true},
+  }};
+  const size_t STRIDE = BorderShaderSource::INSTANCE_FLOATS;
+  const size_t RUN = batched ? count : 1;
+  for (size_t first = 0; first < count; first += RUN) {
+    BorderProgram::upload(packed.data() + first * STRIDE, RUN);
+    for (const auto &[MASK, BLEND] : PASSES) {
+      if (!MASK)
+        continue;
+      glUniform1i(program.uniforms.drawMask, MASK);
+      if (BLEND)
+        glEnable(GL_BLEND);
+      else
+        glDisable(GL_BLEND);
+      glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, RUN);
+      counters.draws++;
+    }
+  }
+
+  BorderProgram::unbind();
+  glFinish();
+}
+
+// What one run of fn adds to the counters
+template <typename F> static SCounters countOnce(F &&fn) {
+  const auto BEFORE = counters;
+  fn();
+  return {
+      .draws = counters.draws - BEFORE.draws,
+      .uploads = counters.uploads - BEFORE.uploads,
+      .uploadBytes = counters.uploadBytes - BEFORE.uploadBytes,
+  };
+}
+
+int main(int argc, char **argv) {
+  SThemeKey key = {
+      .sizes = {16, 16, 16, 16},
+      .horSizes = {8, 8, 8, 8},
+      .verSizes = {8, 8, 8, 8},
+  };
+
+  std::vector<uint8_t> png;
+  if (argc == 5) {
+    std::string error;
+    if (!ImgUtils::readFile(argv[1], png, error) ||
+        !parseInts(argv[2], key.sizes) || !parseInts(argv[3], key.horSizes) ||
+        !parseInts(argv[4], key.verSizes)) {
+      std::fprintf(stderr, "can't read %s %s\n", argv[1], error.c_str());
+      return 1;
+    }
+  } else if (argc == 1)
+    png = generateImage();
+  else {
+    std::fprintf(stderr, "usage: %s [image sizes horsizes versizes]\n",
+                 argv[0]);
+    return 1;
+  }
+
+  if (!makeContext()) {
+    std::fprintf(stderr, "no surfaceless EGL context with GLES 3.2\n");
+    return 1;
+  }
+
+  BorderProgram::SProgram program;
+  std::string error;
+  if (!BorderProgram::create(program, error)) {
+    std::fprintf(stderr, "border shader %s\n", error.c_str());
+    return 1;
+  }
+
+  GLuint fbo = 0;
+  GLuint rbo = 0;
+  glGenFramebuffers(1, &fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glGenRenderbuffers(1, &rbo);
+  glBindRenderbuffer(GL_RENDERBUFFER, rbo);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, OUTPUT_W, OUTPUT_H);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, rbo);
+  glViewport(0, 0, OUTPUT_W, OUTPUT_H);
+  glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+  std::printf("%-32s %14s %8s %8s %12s\n", "", "ns/op", "draws", "uploads",
+              "upload bytes");
+
+  // Load, stage by stage
+  SImageData image;
+  report("decode", measure([&] { ImgUtils::decode(png, image, error); }));
+
+  std::array<CBox, SECTION_COUNT> sections;
+  report("slice", measure([&] {
+           sections = ThemeUtils::layoutSections(key, image.size);
+           ThemeUtils::measureCoverage(image, sections);
+         }));
+
+  SImageData padded;
+  std::array<CBox, SECTION_COUNT> paddedSections;
+  report("pad for mipmaps", measure([&] {
+           ThemeUtils::padSections(image, sections, MIP_LEVELS, padded,
+                                   paddedSections);
+         }));
+
+  for (const bool MIPMAP : {false, true}) {
+    auto loadKey = key;
+    loadKey.mipmap = MIPMAP;
+    STheme theme;
+    const auto PEROP = countOnce([&] { loadTheme(png, loadKey, theme); });
+    unloadTheme(theme);
+    report(MIPMAP ? "load + upload, mipmaps" : "load + upload",
+           measure([&] {
+             loadTheme(png, loadKey, theme);
+             glFinish();
+             unloadTheme(theme);
+           }),
+           PEROP);
+  }
+
+  // Scenes
+  STheme theme;
+  if (!loadTheme(png, key, theme))
+    return 1;
+
+  const auto PARAMS = layoutParams(theme.theme);
+  BorderLayout::SBatch batch;
+  batch.resize(LAYOUT_BATCH);
+  for (int i = 0; i < LAYOUT_BATCH; i++) {
+    batch.width[i] = (float)(i * 37 % OUTPUT_W);
+    batch.height[i] = (float)(i * 53 % OUTPUT_H);
+  }
+  report(std::format("section layout, {} windows", LAYOUT_BATCH),
+         measure([&] { BorderLayout::layout(PARAMS, batch); }));
+
+  std::vector<SBorderInstance> instances;
+  std::vector<float> packed;
+  for (const int COUNT : WINDOW_COUNTS) {
+    report(std::format("layout {} windows", COUNT), measure([&] {
+             layoutScene(COUNT, PARAMS, batch, instances);
+             pack(instances, packed);
+           }));
+
+    for (const bool BATCHED : {true, false}) {
+      const auto DRAW = [&] {
+        drawScene(program, theme, packed, COUNT, BATCHED);
+      };
+      const auto PEROP = countOnce(DRAW);
+      report(std::format("draw {} windows{}", COUNT,
+                         BATCHED ? "" : ", unbatched"),
+             measure(DRAW), PEROP);
+    }
+  }
+
+  // Reload storms: the image changes under a full screen of windows, every
+  // reload decodes, slices and uploads it again and redraws everything
+  layoutScene(STORM_WINDOWS, PARAMS, batch, instances);
+  pack(instances, packed);
+  const auto STORM = [&] {
+    for (int i = 0; i < STORM_RELOADS; i++) {
+      STheme next;
+      if (!loadTheme(png, key, next))
+        return;
+      unloadTheme(theme);
+      theme = std::move(next);
+      drawScene(program, theme, packed, STORM_WINDOWS, true);
+    }
+  };
+  const auto PERSTORM = countOnce(STORM);
+  report(std::format("{} reloads, {} windows", STORM_RELOADS, STORM_WINDOWS),
+         measure(STORM), PERSTORM);
+
+  // Reloads must not leak, the theme on screen is all that's left
+  std::printf("\n%zu texture(s) alive, %zu bytes\n", texturesAlive,
+              bytesAlive);
+
+  unloadTheme(theme);
+  BorderProgram::destroy(program);
+  glDeleteRenderbuffers(1, &rbo);
+  glDeleteFramebuffers(1, &fbo);
+  return 0;
+}
@@ -1,14 +1,41 @@
 #pragma once
 
+#include "BorderAnimator.hpp"
+#include "BorderBatch.hpp"
+#include "BorderCache.hpp"
+#include "BorderManager.hpp"
+#include "BorderShader.hpp"
+#include "BorderStats.hpp"
+#include "ConfigSnapshot.hpp"
+#include "ThemeCache.hpp"
 #include <hyprland/src/plugins/PluginAPI.hpp>
 
 // Plugin API handle
 inline HANDLE PHANDLE = nullptr;
 
-// Class defined elsewhere
-class CImgBorder;
+struct wl_event_source;
+
+// Border layouts reused and rebuilt, since the last render began
+struct SLayoutStats {
+  uint64_t hits = 0;
+  uint64_t recomputes = 0;
+};
 
 struct SGlobalState {
-  std::vector<WP<CImgBorder>> borders;
+  // The latest config, borders made from now on use it
+  SP<const SConfigSnapshot> config;
+  // From imgborders-theme lines, collected while the config is parsed
+  std::unordered_map<std::string, SThemeDecl> themeDecls;
+  CBorderManager borders;
+  SLayoutStats layoutStats;
+  CThemeCache themes;
+  CBorderShader shader;
+  CBorderTextureCache composed;
+  CBorderBatcher batcher;
+  CBorderAnimator animator;
+  // Behind plugin:imgborders:stats and hyprctl imgborders stats
+  CBorderStats stats;
+  // Releases themes of borders that stay off screen
+  wl_event_source *idleTimer = nullptr;
 };
 inline UP<SGlobalState> g_pGlobalState;
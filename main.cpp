@@ -2,80 +2,207 @@
 #include "ImgBorderPassElement.hpp"
 #include "globals.hpp"
 #include <any>
+#include <chrono>
 #include <hyprland/src/Compositor.hpp>
+#include <hyprland/src/SharedDefs.hpp>
 #include <hyprland/src/config/ConfigManager.hpp>
+#include <hyprland/src/debug/Log.hpp>
 #include <hyprland/src/desktop/Window.hpp>
 #include <hyprland/src/helpers/Color.hpp>
+#include <hyprland/src/helpers/Monitor.hpp>
 #include <hyprland/src/plugins/PluginAPI.hpp>
+#include <hyprland/src/render/OpenGL.hpp>
 #include <hyprland/src/render/Renderer.hpp>
 #include <hyprlang.hpp>
 #include <hyprutils/memory/UniquePtr.hpp>
+#include <sstream>
 #include <string>
+#include <vector>
+#include <wayland-server-core.h>
 
 // Do NOT change this function.
 APICALL EXPORT std::string PLUGIN_API_VERSION() { return HYPRLAND_API_VERSION; }
 
-static void addToWindow(PHLWINDOW PWINDOW) {
-  // Create border and apply it
-  auto border = makeUnique<CImgBorder>(PWINDOW);
-  border->m_self = border;
-  g_pGlobalState->borders.emplace_back(border);
-  HyprlandAPI::addWindowDecoration(PHANDLE, PWINDOW, std::move(border));
-}
-
 static void onOpenWindow(void *self, std::any data) {
   // Data is guaranteed
   const auto PWINDOW = std::any_cast<PHLWINDOW>(data);
 
-  if (!PWINDOW->m_X11DoesntWantBorders) {
-    // Make sure we haven't added the border already
-    if (std::ranges::any_of(PWINDOW->m_windowDecorations, [](const auto &d) {
-          return d->getDisplayName() == DISPLAY_NAME;
-        }))
-      return;
-
-    addToWindow(PWINDOW);
-  }
+  // Does nothing if the window already has a border
+  if (!PWINDOW->m_X11DoesntWantBorders)
+    g_pGlobalState->borders.add(PWINDOW);
 }
 
 static void onCloseWindow(void *self, std::any data) {
   // Data is guaranteed
   const auto PWINDOW = std::any_cast<PHLWINDOW>(data);
 
-  const auto BORDER = std::find_if(
-      g_pGlobalState->borders.begin(), g_pGlobalState->borders.end(),
-      [PWINDOW](const auto &b) { return b->getWindow() == PWINDOW; });
+  g_pGlobalState->borders.removeFrom(PWINDOW);
+}
 
-  if (BORDER == g_pGlobalState->borders.end())
-    return;
+static void onActiveWindow(void *self, std::any data) {
+  // Data is null if nothing has focus
+  const auto PWINDOW = std::any_cast<PHLWINDOW>(data);
+
+  // Only the two borders involved redraw, and only if focus shows on them
+  g_pGlobalState->borders.onFocusChanged(PWINDOW);
+}
+
+// Keeps the resampled themes that some border on some monitor draws with
+static void pruneThemeVariants() {
+  std::vector<float> factors;
+  g_pGlobalState->borders.forEach([&factors](CImgBorder &border) {
+    for (const auto &m : g_pCompositor->m_monitors) {
+      const float FACTOR = m->m_scale * border.getScale();
+      if (std::ranges::find(factors, FACTOR) == factors.end())
+        factors.push_back(FACTOR);
+    }
+  });
+
+  g_pHyprRenderer->makeEGLCurrent();
+  g_pGlobalState->themes.pruneVariants(factors);
+}
 
-  // We could use the API but this is faster + it doesn't matter here that much.
-  PWINDOW->removeWindowDeco(BORDER->get());
+static void updateStatsEnabled() {
+  static auto *const PSTATS =
+      (Hyprlang::INT *const *)HyprlandAPI::getConfigValue(
+          PHANDLE, "plugin:imgborders:stats")
+          ->getDataStaticPtr();
+  g_pGlobalState->stats.setEnabled(**PSTATS);
 }
 
 static void onConfigReloaded(void *self, std::any data) {
   // Data is nullptr
 
-  for (auto &b : g_pGlobalState->borders) {
-    b->updateConfig();
+  // Before timing, so the reload that turns stats on is counted
+  updateStatsEnabled();
+  CStatTimer timer(g_pGlobalState->stats, STAT_RELOAD);
+
+  // Parsed once for every border, which then only redo what changed
+  const auto PREV = g_pGlobalState->config;
+  auto config = ConfigUtils::read(PREV ? PREV->generation + 1 : 1,
+                                  g_pGlobalState->themeDecls);
+  Debug::log(LOG, "[imgborders] config generation {}, {} named theme(s)",
+             config->generation, config->themes.size());
+  g_pGlobalState->config = config;
+  g_pGlobalState->borders.applyConfig(config);
+
+  Debug::log(LOG, "[imgborders] theme cache: {} hits, {} misses",
+             g_pGlobalState->themes.m_hits, g_pGlobalState->themes.m_misses);
+
+  static auto *const PCACHE =
+      (Hyprlang::INT *const *)HyprlandAPI::getConfigValue(
+          PHANDLE, "plugin:imgborders:cache")
+          ->getDataStaticPtr();
+
+  pruneThemeVariants();
+  g_pGlobalState->themes.logUsage();
+
+  auto &composed = g_pGlobalState->composed;
+  Debug::log(LOG, "[imgborders] composed cache: {} hits, {} misses, {} KiB",
+             composed.m_hits, composed.m_misses, composed.m_bytes >> 10);
+  if (!**PCACHE) {
+    g_pHyprRenderer->makeEGLCurrent();
+    composed.clear();
+  }
+}
+
+// How often borders are checked for having been off screen long enough
+constexpr int IDLE_CHECK_MS = 5000;
+
+static int onIdleTimer(void *data) {
+  static auto *const PIDLE =
+      (Hyprlang::INT *const *)HyprlandAPI::getConfigValue(
+          PHANDLE, "plugin:imgborders:idle_release")
+          ->getDataStaticPtr();
+
+  if (**PIDLE > 0) {
+    // Last references to themes may go, taking their textures with them
+    g_pHyprRenderer->makeEGLCurrent();
+
+    if (g_pGlobalState->borders.releaseIdle(std::chrono::steady_clock::now(),
+                                            std::chrono::seconds(**PIDLE)))
+      g_pGlobalState->composed.dropExpired();
   }
+
+  wl_event_source_timer_update(g_pGlobalState->idleTimer, IDLE_CHECK_MS);
+  return 0;
+}
+
+static Hyprlang::CParseResult onThemeKeyword(const char *command,
+                                             const char *value) {
+  Hyprlang::CParseResult result;
+  std::string error;
+  if (!ConfigUtils::declareTheme(value, g_pGlobalState->themeDecls, error))
+    result.setError(std::format("imgborders-theme: {}", error).c_str());
+  return result;
 }
 
 static void onWindowUpdateRules(void *self, std::any data) {
   // Data is guaranteed
   const auto PWINDOW = std::any_cast<PHLWINDOW>(data);
 
-  const auto BORDER = std::find_if(
-      g_pGlobalState->borders.begin(), g_pGlobalState->borders.end(),
-      [PWINDOW](const auto &b) { return b->getWindow() == PWINDOW; });
-
-  if (BORDER == g_pGlobalState->borders.end())
+  const auto BORDER = g_pGlobalState->borders.get(PWINDOW);
+  if (!BORDER)
     return;
 
-  (*BORDER)->updateRules();
+  BORDER->updateRules();
   PWINDOW->updateWindowDecos();
 }
 
+// hyprctl imgborders stats [reset]
+static std::string onHyprCtl(eHyprCtlOutputFormat format,
+                             std::string request) {
+  std::vector<std::string> args;
+  std::istringstream stream(request);
+  for (std::string arg; stream >> arg;)
+    args.push_back(arg);
+
+  auto &stats = g_pGlobalState->stats;
+  if (args.size() < 2 || args[1] != "stats")
+    return "usage: hyprctl imgborders stats [reset]";
+
+  if (args.size() > 2 && args[2] == "reset") {
+    stats.reset();
+    return "ok";
+  }
+
+  // Counted now, on the compositor thread like everything that frees them
+  SMemoryStats memory;
+  g_pGlobalState->themes.usage(memory.themeTextures, memory.themeBytes);
+  memory.composedTextures = g_pGlobalState->composed.size();
+  memory.composedBytes = g_pGlobalState->composed.m_bytes;
+
+  return format == FORMAT_JSON ? stats.toJson(memory) : stats.toText(memory);
+}
+
+static void onRender(void *self, std::any data) {
+  // Data is guaranteed
+  const auto STAGE = std::any_cast<eRenderStage>(data);
+
+  switch (STAGE) {
+  case RENDER_BEGIN: {
+    auto &stats = g_pGlobalState->layoutStats;
+    if (stats.hits || stats.recomputes)
+      Debug::log(TRACE, "[imgborders] layouts: {} reused, {} recomputed",
+                 stats.hits, stats.recomputes);
+    stats = {};
+
+    g_pGlobalState->stats.beginFrame();
+    g_pGlobalState->batcher.beginFrame();
+    break;
+  }
+  case RENDER_PRE_WINDOW:
+    g_pGlobalState->batcher.onRenderWindow(
+        g_pHyprOpenGL->m_renderData.currentWindow.lock());
+    break;
+  case RENDER_POST_WINDOWS:
+    g_pGlobalState->batcher.close();
+    break;
+  default:
+    break;
+  }
+}
+
 APICALL EXPORT PLUGIN_DESCRIPTION_INFO PLUGIN_INIT(HANDLE handle) {
   PHANDLE = handle;
 
@@ -106,8 +233,28 @@ APICALL EXPORT PLUGIN_DESCRIPTION_INFO PLUGIN_INIT(HANDLE handle) {
                               Hyprlang::FLOAT{1});
   HyprlandAPI::addConfigValue(PHANDLE, "plugin:imgborders:smooth",
                               Hyprlang::INT{1});
+  HyprlandAPI::addConfigValue(PHANDLE, "plugin:imgborders:frames",
+                              Hyprlang::INT{1});
+  HyprlandAPI::addConfigValue(PHANDLE, "plugin:imgborders:fps",
+                              Hyprlang::FLOAT{10});
+  HyprlandAPI::addConfigValue(PHANDLE, "plugin:imgborders:states",
+                              Hyprlang::INT{1});
+  HyprlandAPI::addConfigValue(PHANDLE, "plugin:imgborders:mipmap",
+                              Hyprlang::INT{0});
+  HyprlandAPI::addConfigValue(PHANDLE, "plugin:imgborders:compact",
+                              Hyprlang::INT{0});
   HyprlandAPI::addConfigValue(PHANDLE, "plugin:imgborders:blur",
                               Hyprlang::INT{0});
+  HyprlandAPI::addConfigValue(PHANDLE, "plugin:imgborders:batch",
+                              Hyprlang::INT{1});
+  HyprlandAPI::addConfigValue(PHANDLE, "plugin:imgborders:cache",
+                              Hyprlang::INT{0});
+  HyprlandAPI::addConfigValue(PHANDLE, "plugin:imgborders:cache_size",
+                              Hyprlang::INT{64});
+  HyprlandAPI::addConfigValue(PHANDLE, "plugin:imgborders:idle_release",
+                              Hyprlang::INT{120});
+  HyprlandAPI::addConfigValue(PHANDLE, "plugin:imgborders:stats",
+                              Hyprlang::INT{0});
   HyprlandAPI::addConfigValue(PHANDLE, "plugin:imgborders:horsizes", 
                               Hyprlang::STRING{""});
   HyprlandAPI::addConfigValue(PHANDLE, "plugin:imgborders:versizes", 
@@ -121,6 +268,10 @@ APICALL EXPORT PLUGIN_DESCRIPTION_INFO PLUGIN_INIT(HANDLE handle) {
   HyprlandAPI::addConfigValue(PHANDLE, "plugin:imgborders:rightplacements", 
                               Hyprlang::STRING{""});
 
+  // Named themes, one imgborders-theme line per option
+  HyprlandAPI::addConfigKeyword(PHANDLE, "imgborders-theme", onThemeKeyword,
+                                Hyprlang::SHandlerOptions{});
+
   // Register callbacks
   static auto openWindow = HyprlandAPI::registerCallbackDynamic(
       PHANDLE, "openWindow",
@@ -132,22 +283,56 @@ APICALL EXPORT PLUGIN_DESCRIPTION_INFO PLUGIN_INIT(HANDLE handle) {
       [&](void *self, SCallbackInfo &info, std::any data) {
         onCloseWindow(self, data);
       });
+  static auto activeWindow = HyprlandAPI::registerCallbackDynamic(
+      PHANDLE, "activeWindow",
+      [&](void *self, SCallbackInfo &info, std::any data) {
+        onActiveWindow(self, data);
+      });
+  // imgborders-theme lines are collected anew on every reload
+  static auto preReloadConfig = HyprlandAPI::registerCallbackDynamic(
+      PHANDLE, "preConfigReload",
+      [&](void *self, SCallbackInfo &info, std::any data) {
+        g_pGlobalState->themeDecls.clear();
+      });
   static auto reloadConfig = HyprlandAPI::registerCallbackDynamic(
       PHANDLE, "configReloaded",
       [&](void *self, SCallbackInfo &info, std::any data) {
         onConfigReloaded(self, data);
       });
+  static auto monitorLayoutChanged = HyprlandAPI::registerCallbackDynamic(
+      PHANDLE, "monitorLayoutChanged",
+      [&](void *self, SCallbackInfo &info, std::any data) {
+        pruneThemeVariants();
+        g_pGlobalState->themes.logUsage();
+      });
   static auto windowUpdateRules = HyprlandAPI::registerCallbackDynamic(
       PHANDLE, "windowUpdateRules",
       [&](void *self, SCallbackInfo &info, std::any data) {
         onWindowUpdateRules(self, data);
       });
+  static auto render = HyprlandAPI::registerCallbackDynamic(
+      PHANDLE, "render", [&](void *self, SCallbackInfo &info, std::any data) {
+        onRender(self, data);
+      });
 
-  // Add to existing windows
+  static auto hyprCtl = HyprlandAPI::registerHyprCtlCommand(
+      PHANDLE, SHyprCtlCommand{
+                   .name = "imgborders", .exact = false, .fn = onHyprCtl});
+
+  g_pGlobalState->config =
+      ConfigUtils::read(1, g_pGlobalState->themeDecls);
+  updateStatsEnabled();
+
+  g_pGlobalState->idleTimer = wl_event_loop_add_timer(
+      g_pCompositor->m_wlEventLoop, onIdleTimer, nullptr);
+  if (g_pGlobalState->idleTimer)
+    wl_event_source_timer_update(g_pGlobalState->idleTimer, IDLE_CHECK_MS);
+
+  // Add to existing windows. They load their theme once they're drawn.
   for (auto &w : g_pCompositor->m_windows) {
     if (w->isHidden() || !w->m_isMapped)
       continue;
-    addToWindow(w);
+    g_pGlobalState->borders.add(w);
   }
 
   // Yay let's go
@@ -162,4 +347,17 @@ APICALL EXPORT void PLUGIN_EXIT() {
     m->m_scheduledRecalc = true;
 
   g_pHyprRenderer->m_renderPass.removeAllOfType(PASS_NAME);
+
+  if (g_pGlobalState->idleTimer) {
+    wl_event_source_remove(g_pGlobalState->idleTimer);
+    g_pGlobalState->idleTimer = nullptr;
+  }
+  g_pGlobalState->animator.stop();
+
+  g_pGlobalState->themes.stop();
+
+  g_pHyprRenderer->makeEGLCurrent();
+  g_pGlobalState->composed.clear();
+  g_pGlobalState->shader.destroy();
+  g_pGlobalState->stats.destroy();
 }
@@ -0,0 +1,235 @@
+// Checks ImgUtils::compact by reading what it packs back the way GL would,
+// normalized and swizzled, and comparing that to the RGBA8 upload it
+// replaces.
+
+#include "ImgUtils.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      std::fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond);          \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+struct SPixel {
+  uint8_t r, g, b, a;
+
+  bool operator==(const SPixel &) const = default;
+};
+
+// A row of pixels as decoding leaves them. Cairo's come as BGRA, opaque ones
+// with a padding byte where alpha would be.
+static SImageData makeImage(const std::vector<SPixel> &pixels, bool swapRB,
+                            bool noAlpha) {
+  SImageData image;
+  image.size = {(double)pixels.size(), 1};
+  image.swapRB = swapRB;
+  image.noAlpha = noAlpha;
+  for (const auto &P : pixels) {
+    const uint8_t A = noAlpha ? 0x5A : P.a;
+    if (swapRB)
+      image.pixels.insert(image.pixels.end(), {P.b, P.g, P.r, A});
+    else
+      image.pixels.insert(image.pixels.end(), {P.r, P.g, P.b, A});
+  }
+  return image;
+}
+
+// Normalized value of an n bit channel
+static double unorm(unsigned v, int bits) {
+  return v / double((1 << bits) - 1);
+}
+
+// What the shader gets from texel i, written to an RGBA8 target
+static SPixel sample(const SImageData &image, size_t i) {
+  // Channels the format doesn't have read as 0, alpha as 1
+  double c[4] = {0, 0, 0, 1};
+  const auto *p = image.data();
+
+  if (image.type == GL_UNSIGNED_SHORT_5_6_5 ||
+      image.type == GL_UNSIGNED_SHORT_4_4_4_4) {
+    uint16_t v = 0;
+    std::memcpy(&v, p + i * 2, sizeof(v));
+    if (image.type == GL_UNSIGNED_SHORT_5_6_5) {
+      c[0] = unorm(v >> 11, 5);
+      c[1] = unorm(v >> 5 & 63, 6);
+      c[2] = unorm(v & 31, 5);
+    } else {
+      for (int k = 0; k < 4; k++)
+        c[k] = unorm(v >> (12 - k * 4) & 15, 4);
+    }
+  } else {
+    const int CHANNELS = image.format == GL_RED ? 1
+                         : image.format == GL_RG ? 2
+                                                 : 4;
+    for (int k = 0; k < CHANNELS; k++)
+      c[k] = unorm(p[i * CHANNELS + k], 8);
+  }
+
+  // Without its own swizzle, what texImage sets up for cairo's order
+  const auto SWIZZLE = image.swizzle.value_or(std::array<GLint, 4>{
+      image.swapRB ? GL_BLUE : GL_RED, GL_GREEN,
+      image.swapRB ? GL_RED : GL_BLUE, image.noAlpha ? GL_ONE : GL_ALPHA});
+
+  uint8_t out[4];
+  for (int k = 0; k < 4; k++) {
+    double v = 0;
+    switch (SWIZZLE[k]) {
+    case GL_RED:
+      v = c[0];
+      break;
+    case GL_GREEN:
+      v = c[1];
+      break;
+    case GL_BLUE:
+      v = c[2];
+      break;
+    case GL_ALPHA:
+      v = c[3];
+      break;
+    case GL_ONE:
+      v = 1;
+      break;
+    default:
+      break;
+    }
+    out[k] = (uint8_t)std::lround(v * 255);
+  }
+  return {out[0], out[1], out[2], out[3]};
+}
+
+// Compacts pixels and checks they come out as format, reading back the same
+static void roundTrip(const std::vector<SPixel> &pixels, bool swapRB,
+                      bool noAlpha, bool allow16, const char *format) {
+  auto image = makeImage(pixels, swapRB, noAlpha);
+  const auto BEFORE = image.pixels;
+  ImgUtils::compact(image, allow16);
+
+  const bool SAME = std::strcmp(ImgUtils::formatName(image), format) == 0;
+  if (!SAME)
+    std::fprintf(stderr, "  came out as %s, not %s\n",
+                 ImgUtils::formatName(image), format);
+  CHECK(SAME);
+  CHECK(image.pixels.size() == pixels.size() * ImgUtils::texelBytes(image));
+
+  // Left alone, not just as RGBA8 again
+  if (std::strcmp(format, "RGBA8") == 0) {
+    CHECK(!image.swizzle);
+    CHECK(image.pixels == BEFORE);
+  }
+
+  for (size_t i = 0; i < pixels.size(); i++) {
+    const auto WANT =
+        noAlpha ? SPixel{pixels[i].r, pixels[i].g, pixels[i].b, 255}
+                : pixels[i];
+    const auto GOT = sample(image, i);
+    if (GOT != WANT)
+      std::fprintf(stderr,
+                   "  pixel %zu read back as %d,%d,%d,%d, not %d,%d,%d,%d\n",
+                   i, GOT.r, GOT.g, GOT.b, GOT.a, WANT.r, WANT.g, WANT.b,
+                   WANT.a);
+    CHECK(GOT == WANT);
+  }
+}
+
+// Every value a channel of that many bits holds, widened to 8
+static std::vector<uint8_t> levels(int bits) {
+  std::vector<uint8_t> out;
+  for (int q = 0; q < 1 << bits; q++)
+    out.push_back((uint8_t)std::lround(unorm(q, bits) * 255));
+  return out;
+}
+
+static void testGrey() {
+  std::vector<SPixel> opaque, translucent;
+  for (int v = 0; v < 256; v++) {
+    opaque.push_back({(uint8_t)v, (uint8_t)v, (uint8_t)v, 255});
+    translucent.push_back({(uint8_t)v, (uint8_t)v, (uint8_t)v,
+                           (uint8_t)(255 - v)});
+  }
+
+  for (const bool SWAP : {false, true}) {
+    roundTrip(opaque, SWAP, false, false, "R8");
+    roundTrip(translucent, SWAP, false, false, "RG8");
+    // The padding byte isn't alpha
+    roundTrip(translucent, SWAP, true, false, "R8");
+  }
+}
+
+static void test565() {
+  // Red and blue differ, so swapped channels would show
+  std::vector<SPixel> pixels;
+  const auto FIVE = levels(5), SIX = levels(6);
+  for (size_t i = 0; i < SIX.size(); i++)
+    pixels.push_back({FIVE[i % FIVE.size()], SIX[i],
+                      FIVE[FIVE.size() - 1 - i % FIVE.size()], 255});
+
+  for (const bool SWAP : {false, true}) {
+    roundTrip(pixels, SWAP, false, true, "RGB565");
+    roundTrip(pixels, SWAP, true, true, "RGB565");
+    roundTrip(pixels, SWAP, false, false, "RGBA8");
+  }
+}
+
+static void test4444() {
+  std::vector<SPixel> pixels;
+  const auto FOUR = levels(4);
+  for (size_t i = 0; i < FOUR.size(); i++)
+    pixels.push_back({FOUR[i], FOUR[(i + 5) % 16], FOUR[15 - i],
+                      FOUR[(i + 9) % 16]});
+
+  for (const bool SWAP : {false, true}) {
+    roundTrip(pixels, SWAP, false, true, "RGBA4");
+    roundTrip(pixels, SWAP, false, false, "RGBA8");
+  }
+
+  // Opaque and fitting both, the one with more green wins
+  roundTrip({{255, 0, 0, 255}, {0, 255, 255, 255}, {255, 0, 255, 255}}, true,
+            false, true, "RGB565");
+}
+
+static void testUnrepresentable() {
+  for (const bool SWAP : {false, true}) {
+    // 1 is lost in 5 bits, and 4 bits can't hold 254
+    roundTrip({{1, 8, 16, 255}}, SWAP, false, true, "RGBA8");
+    roundTrip({{17, 34, 51, 254}}, SWAP, false, true, "RGBA8");
+    // Opaque without its padding byte, but 17 is lost in 5 bits
+    roundTrip({{17, 34, 51, 254}}, SWAP, true, true, "RGBA4");
+
+    // One pixel that doesn't fit keeps the whole image as is
+    std::vector<SPixel> pixels(64, SPixel{0, 0, 255, 255});
+    pixels[37] = {0, 2, 255, 255};
+    roundTrip(pixels, SWAP, false, true, "RGBA8");
+    // Nearly grey
+    pixels[37] = {100, 100, 101, 255};
+    roundTrip(pixels, SWAP, false, true, "RGBA8");
+  }
+
+  // Not 8-bit RGBA to begin with
+  SImageData hdr;
+  hdr.size = {1, 1};
+  hdr.type = GL_HALF_FLOAT;
+  hdr.internalFormat = GL_RGBA16F;
+  hdr.pixels.assign(8, 0);
+  ImgUtils::compact(hdr, true);
+  CHECK(!hdr.swizzle && hdr.internalFormat == GL_RGBA16F &&
+        hdr.pixels.size() == 8);
+}
+
+int main() {
+  testGrey();
+  test565();
+  test4444();
+  testUnrepresentable();
+
+  if (failures)
+    std::fprintf(stderr, "%d check(s) failed\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,213 @@
+// Checks BorderLayout::layout against boxes worked out by hand, for plain
+// borders and for the edge cases the shader has to agree with.
+
+#include "BorderLayout.hpp"
+#include <cmath>
+#include <cstdio>
+#include <initializer_list>
+#include <limits>
+#include <utility>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      std::fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond);          \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+constexpr float NOT_A_NUMBER = std::numeric_limits<float>::quiet_NaN();
+constexpr float INF = std::numeric_limits<float>::infinity();
+
+// Piece p of edge (top, right, bottom, left), in the order sections are
+// stored: before c1, c1, between, c2, after c2
+static size_t piece(size_t edge, size_t p) { return 4 + edge * 5 + p; }
+
+struct SBox {
+  float x, y, w, h;
+};
+
+static bool near(float a, float b) { return std::abs(a - b) < 1e-4F; }
+
+static bool sectionIs(const BorderLayout::SBatch &batch, size_t window,
+                      size_t section, SBox box) {
+  const size_t AT = section * batch.count + window;
+  return near(batch.x[AT], box.x) && near(batch.y[AT], box.y) &&
+         near(batch.w[AT], box.w) && near(batch.h[AT], box.h);
+}
+
+// Every custom piece 10 long at 25% and 75%
+static BorderLayout::SParams plainParams() {
+  BorderLayout::SParams params;
+  params.borders = {4, 6, 3, 5};
+  params.placements.fill(0);
+  for (size_t edge = 0; edge < BorderLayout::EDGES; edge++) {
+    params.placements[edge * 2] = 25;
+    params.placements[edge * 2 + 1] = 75;
+  }
+  params.customLengths.fill(10);
+  return params;
+}
+
+static void layOut(const BorderLayout::SParams &params,
+                   BorderLayout::SBatch &batch,
+                   std::initializer_list<std::pair<float, float>> sizes) {
+  batch.resize(sizes.size());
+  size_t i = 0;
+  for (const auto &[W, H] : sizes) {
+    batch.width[i] = W;
+    batch.height[i] = H;
+    i++;
+  }
+  BorderLayout::layout(params, batch);
+}
+
+static void testPlain() {
+  BorderLayout::SBatch batch;
+  // The second window makes sure windows don't bleed into each other
+  layOut(plainParams(), batch, {{100, 60}, {50, 40}});
+
+  CHECK(batch.drawable[0] && batch.drawable[1]);
+
+  // Corners
+  CHECK(sectionIs(batch, 0, 0, {0, 0, 4, 3}));
+  CHECK(sectionIs(batch, 0, 1, {94, 0, 6, 3}));
+  CHECK(sectionIs(batch, 0, 2, {94, 55, 6, 5}));
+  CHECK(sectionIs(batch, 0, 3, {0, 55, 4, 5}));
+  CHECK(sectionIs(batch, 1, 2, {44, 35, 6, 5}));
+
+  // Top, 90 between the corners
+  CHECK(near(batch.placements[0 * batch.count], 22.5F));
+  CHECK(near(batch.placements[1 * batch.count], 67.5F));
+  CHECK(sectionIs(batch, 0, piece(0, 0), {4, 0, 22.5F, 3}));
+  CHECK(sectionIs(batch, 0, piece(0, 1), {26.5F, 0, 10, 3}));
+  CHECK(sectionIs(batch, 0, piece(0, 2), {36.5F, 0, 35, 3}));
+  CHECK(sectionIs(batch, 0, piece(0, 3), {71.5F, 0, 10, 3}));
+  CHECK(sectionIs(batch, 0, piece(0, 4), {81.5F, 0, 12.5F, 3}));
+
+  // Right, 52 between the corners
+  CHECK(sectionIs(batch, 0, piece(1, 0), {94, 3, 6, 13}));
+  CHECK(sectionIs(batch, 0, piece(1, 1), {94, 16, 6, 10}));
+  CHECK(sectionIs(batch, 0, piece(1, 4), {94, 52, 6, 3}));
+
+  // Bottom and left of the second window, 40 and 32 between the corners
+  CHECK(sectionIs(batch, 1, piece(2, 0), {4, 35, 10, 5}));
+  CHECK(sectionIs(batch, 1, piece(2, 4), {44, 35, 0, 5}));
+  CHECK(sectionIs(batch, 1, piece(3, 3), {0, 27, 4, 8}));
+}
+
+static void testZeroMiddles() {
+  BorderLayout::SBatch batch;
+  // Exactly as wide or high as the borders, thinner, and just wider
+  layOut(plainParams(), batch,
+         {{10, 60}, {100, 8}, {9, 60}, {100, 7}, {10.01F, 8.01F}});
+
+  CHECK(!batch.drawable[0]);
+  CHECK(!batch.drawable[1]);
+  CHECK(!batch.drawable[2]);
+  CHECK(!batch.drawable[3]);
+  CHECK(batch.drawable[4]);
+
+  // Nothing between the corners, every piece of the top is empty
+  for (size_t p = 0; p < 5; p++)
+    CHECK(batch.w[piece(0, p) * batch.count + 0] == 0.F);
+}
+
+static void testOverlappingPlacements() {
+  auto params = plainParams();
+  params.borders = {5, 5, 5, 5};
+  // c2 starts before c1, which cuts c1 and what follows it off
+  params.placements[0] = 50;
+  params.placements[1] = 40;
+  // c2 runs past the corner and gets clamped
+  params.placements[2] = 10;
+  params.placements[3] = 95;
+
+  BorderLayout::SBatch batch;
+  layOut(params, batch, {{110, 110}});
+  CHECK(batch.drawable[0]);
+
+  CHECK(sectionIs(batch, 0, piece(0, 0), {5, 0, 40, 5}));
+  CHECK(sectionIs(batch, 0, piece(0, 1), {55, 0, 0, 5}));
+  CHECK(sectionIs(batch, 0, piece(0, 2), {65, 0, 0, 5}));
+  CHECK(sectionIs(batch, 0, piece(0, 3), {45, 0, 10, 5}));
+  CHECK(sectionIs(batch, 0, piece(0, 4), {55, 0, 50, 5}));
+
+  CHECK(sectionIs(batch, 0, piece(1, 3), {105, 100, 5, 5}));
+  CHECK(sectionIs(batch, 0, piece(1, 4), {105, 105, 5, 0}));
+
+  // Pieces of an edge always add up to the space between the corners
+  for (size_t edge = 0; edge < BorderLayout::EDGES; edge++) {
+    float total = 0;
+    for (size_t p = 0; p < 5; p++) {
+      const size_t AT = piece(edge, p) * batch.count;
+      total += edge % 2 == 0 ? batch.w[AT] : batch.h[AT];
+    }
+    CHECK(near(total, 100));
+  }
+}
+
+static void testInvalid() {
+  CHECK(BorderLayout::validParams(plainParams()));
+
+  // Placements may be anywhere, they're clamped to the edge
+  auto params = plainParams();
+  params.placements[0] = -20;
+  CHECK(BorderLayout::validParams(params));
+
+  params = plainParams();
+  params.placements[5] = NOT_A_NUMBER;
+  CHECK(!BorderLayout::validParams(params));
+  params = plainParams();
+  params.placements[5] = INF;
+  CHECK(!BorderLayout::validParams(params));
+
+  params = plainParams();
+  params.borders[2] = -1;
+  CHECK(!BorderLayout::validParams(params));
+  params = plainParams();
+  params.borders[0] = NOT_A_NUMBER;
+  CHECK(!BorderLayout::validParams(params));
+
+  params = plainParams();
+  params.customLengths[7] = -0.5F;
+  CHECK(!BorderLayout::validParams(params));
+  params = plainParams();
+  params.customLengths[1] = INF;
+  CHECK(!BorderLayout::validParams(params));
+
+  // A NaN or negative scale ends up in every border. A batch laid out fine
+  // before is left with nothing drawable.
+  for (const float SCALE : {NOT_A_NUMBER, -1.F}) {
+    BorderLayout::SBatch batch;
+    layOut(plainParams(), batch, {{100, 60}});
+    CHECK(batch.drawable[0]);
+
+    params = plainParams();
+    for (auto &border : params.borders)
+      border *= SCALE;
+    BorderLayout::layout(params, batch);
+    CHECK(!batch.drawable[0]);
+  }
+
+  // Valid params, but a window size that isn't a number
+  BorderLayout::SBatch batch;
+  layOut(plainParams(), batch,
+         {{NOT_A_NUMBER, 60}, {100, NOT_A_NUMBER}, {100, 60}});
+  CHECK(!batch.drawable[0]);
+  CHECK(!batch.drawable[1]);
+  CHECK(batch.drawable[2]);
+}
+
+int main() {
+  testPlain();
+  testZeroMiddles();
+  testOverlappingPlacements();
+  testInvalid();
+
+  if (failures)
+    std::fprintf(stderr, "%d check(s) failed\n", failures);
+  return failures ? 1 : 0;
+}